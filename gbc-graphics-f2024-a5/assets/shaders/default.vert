@@ -4,9 +4,50 @@ layout (location = 0) in vec3 aPosition;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTcoord;
 
+#ifdef INSTANCED
+// Per-instance attributes of DrawMeshInstanced. Matrix is stored row by row,
+// so the attribute's columns are the world matrix's rows & vectors multiply it from the left
+layout (location = 3) in mat4 aWorld;
+layout (location = 7) in vec3 aColor;
+
+uniform mat4 u_viewProj;
+
+out vec3 color;
+#elif defined(POOLED)
+// Per-draw data of DrawGeometryPool, one per command of the multi-draw. Must match PoolDraw in GeometryPool.h.
+// Matrices are stored row by row like the instanced ones
+struct Draw
+{
+   mat4 world;
+   mat4 normal;
+   vec4 color;
+   vec4 atlasRect;
+   int atlasLayer;
+};
+
+layout (std430, binding = 1) readonly buffer Draws
+{
+   Draw u_draws[];
+};
+
+uniform mat4 u_viewProj;
+
+out vec3 color;
+#else
 uniform mat4 u_mvp;
 uniform mat4 u_world;
 uniform mat3 u_normal;
+#endif
+
+#ifdef ATLAS
+// Where the draw's image was packed in its TextureAtlas. Pooled draws carry their own
+#ifndef POOLED
+uniform vec4 u_atlasRect;
+uniform int u_atlasLayer;
+#endif
+
+flat out int layer;
+#endif
 
 out vec3 position;
 out vec3 normal;
@@ -14,9 +55,37 @@ out vec2 tcoord;
 
 void main()
 {
+#ifdef INSTANCED
+   vec4 world = vec4(aPosition, 1.0) * aWorld;
+   position = world.xyz;
+   normal = (vec4(aNormal, 0.0) * aWorld).xyz;   // Assumes a uniform scale
+   tcoord = aTcoord;
+   color = aColor;
+
+   gl_Position = u_viewProj * world;
+#elif defined(POOLED)
+   Draw draw = u_draws[gl_DrawID];
+   vec4 world = vec4(aPosition, 1.0) * draw.world;
+   position = world.xyz;
+   normal = (vec4(aNormal, 0.0) * draw.normal).xyz;
+   tcoord = aTcoord;
+   color = draw.color.rgb;
+#ifdef ATLAS
+   tcoord = aTcoord * draw.atlasRect.zw + draw.atlasRect.xy;
+   layer = draw.atlasLayer;
+#endif
+
+   gl_Position = u_viewProj * world;
+#else
    position = (u_world * vec4(aPosition, 1.0)).xyz;
    normal = u_normal * aNormal;
    tcoord = aTcoord;
 
    gl_Position = u_mvp * vec4(aPosition, 1.0);
+#endif
+
+#if defined(ATLAS) && !defined(POOLED)
+   tcoord = aTcoord * u_atlasRect.zw + u_atlasRect.xy;
+   layer = u_atlasLayer;
+#endif
 }
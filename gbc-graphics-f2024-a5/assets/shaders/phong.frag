@@ -1,74 +1,139 @@
 #version 460 core
 
+// Features, defined by PhongDefines in Light.cpp. Each one left undefined is work this variant skips:
+// TEXTURED		albedo from u_tex rather than grey
+// NUM_LIGHTS	how many lights the Lights block holds, so the loop can be unrolled (u_lightCount if undefined)
+// SPOT			spot lights are lit (skipped otherwise)
+// ATTENUATION	point & direction lights are dimmed by radius / distance
+
+// Inputs
 in vec3 position;
 in vec3 normal;
+in vec2 tcoord;
 
+// Outputs
 out vec4 FragColor;
 
-// TODO for yourself: figure out how to send more than 1 light worth of information to this shader
-uniform vec3 u_camPos;
-uniform vec3 u_litePos;
-uniform vec3 u_liteDir;
-uniform vec3 u_liteCol;
-uniform float u_liteRad;
+// Uniforms
+#ifdef TEXTURED
+uniform sampler2D u_tex;
+#endif
+
+// Must match MAX_LIGHTS & LightType in Light.h
+#define MAX_LIGHTS 256
+#define LIGHT_POINT 0
+#define LIGHT_DIRECTION 1
+#define LIGHT_SPOT 2
+
+struct Light
+{
+	vec3 position;
+	float radius;	// Not attenuated if 0
+	vec3 color;
+	int type;
+	vec3 direction;
+	float angle;	// Spot light cone in degrees
+};
+
+// Uploaded once per frame, shared by every Phong program
+layout(std140, binding = 0) uniform Lights
+{
+	vec3 u_camPos;
+	int u_lightCount;
+	Light u_lights[MAX_LIGHTS];
+};
 
-uniform float u_facAmb;
-uniform float u_facDfue;
-uniform float u_powSpur;
+#ifdef NUM_LIGHTS
+#define LIGHT_COUNT NUM_LIGHTS
+#else
+#define LIGHT_COUNT u_lightCount
+#endif
 
-vec3 phong(vec3 position, vec3 normal, vec3 camera, vec3 light, vec3 color, float ambientFactor, float diffuseFactor, float specularPower)
+// radius / distance, clamped to 1
+float attenuation(Light light)
 {
-    vec3 N = normalize(normal);
-    vec3 L = normalize(light - position);
-    vec3 V = normalize(camera - position);
-    vec3 R = normalize(reflect(-L, N));
-    float dotNL = max(dot(N, L), 0.0);
-    float dotVR = max(dot(V, R), 0.0);
-
-    vec3 lighting = vec3(0.0);
-    vec3 ambient = color * ambientFactor;
-    vec3 diffuse = color * dotNL * diffuseFactor;
-    vec3 specular = color * pow(dotVR, specularPower);
-
-    lighting += ambient;
-    lighting += diffuse;
-    lighting += specular;
-    return lighting;
+#ifdef ATTENUATION
+	if (light.radius > 0.0)
+		return clamp(light.radius / length(light.position - position), 0.0, 1.0);
+#endif
+	return 1.0;
 }
 
-// Phong but attenuated
-vec3 point_light(vec3 position, vec3 normal, vec3 camera, vec3 light, vec3 color, float ambientFactor, float diffuseFactor, float specularPower, float radius)
+// Phong attenuated by radius / distance
+vec3 point_light(Light light, vec3 n)
 {
-    vec3 lighting = phong(position, normal, u_camPos, u_litePos, u_liteCol, u_facAmb, u_facDfue, u_powSpur);
+	vec3 l = normalize(light.position - position);
+	vec3 v = normalize(u_camPos - position);
+	vec3 r = reflect(-l, n);
 
-    float dist = length(light - position);
-    float attenuation = clamp(radius / dist, 0.0, 1.0);
-    lighting *= attenuation;
+	float orbNL = max(dot(n, l), 0.0);
+	float orbVR = max(dot(v, r), 0.0);
 
-    return lighting;
+	vec3 orbAmb = light.color * 0.4;
+	vec3 orbDfue = light.color * orbNL * 1.5;
+	vec3 orbSpur = light.color * pow(orbVR, 32);
+
+	return (orbAmb + orbDfue + orbSpur) * attenuation(light);
 }
 
-// Phong but based on direction only
-vec3 direction_light(vec3 direction, vec3 normal, vec3 camera, vec3 color, float ambientFactor, float diffuseFactor, float specularPower)
+// Ambient & diffuse attenuated by radius / distance
+vec3 direction_light(Light light, vec3 n)
 {
-    vec3 lighting = phong(vec3(0.0), normal, u_camPos, -direction, u_liteCol, u_facAmb, u_facDfue, u_powSpur);
-    return lighting;
+	vec3 dirL = normalize(light.position - position);
+	float dirNL = max(dot(n, dirL), 0.0);
+
+	vec3 dirAmb = light.color * 0.4;
+	vec3 dirDfue = light.color * dirNL;
+
+	return (dirAmb + dirDfue) * attenuation(light);
 }
 
-// Phong but attenuated & within field of view (fov)
-vec3 spot_light(vec3 position, vec3 direction, vec3 normal, vec3 camera, vec3 light, vec3 color, float ambientFactor, float diffuseFactor, float specularPower, float radius, float fov)
+// Ambient within a cone around the light's direction
+vec3 spot_light(Light light)
 {
-    // TODO -- figure this out for yourself
-    vec3 lighting = vec3(0.0);
-    return lighting;
+	vec3 spoL = normalize(position - light.position);
+	vec3 spoD = normalize(-light.direction);
+	float spoLD = dot(spoL, spoD);
+
+	float incut = cos(radians(light.angle * 0.5));
+	float outcut = cos(radians((light.angle * 0.5) + 0.5));
+	float cut = incut - outcut;
+	float spoTenz = clamp((spoLD - outcut) / cut, 0.0, 1.0);
+
+	vec3 spoAmb = light.color * 0.4;
+	return spoAmb * spoTenz;
+}
+
+vec3 all_lights()
+{
+	vec3 n = normalize(normal);
+	vec3 lighting = vec3(0.0);
+	for (int i = 0; i < LIGHT_COUNT; i++)
+	{
+		Light light = u_lights[i];
+		if (light.type == LIGHT_POINT)
+			lighting += point_light(light, n);
+		else if (light.type == LIGHT_DIRECTION)
+			lighting += direction_light(light, n);
+#ifdef SPOT
+		else
+			lighting += spot_light(light);
+#endif
+	}
+	return lighting;
 }
 
 void main()
 {
-    //vec3 lighting = point_light(position, normal, u_cameraPosition, u_lightPosition, u_lightColor, u_ambientFactor, u_diffuseFactor, u_specularPower, u_lightRadius);
-    vec3 lighting = direction_light(u_liteDir, normal, u_camPos, u_liteCol, u_facAmb, u_facDfue, u_powSpur);
-    // TODO -- test spot light and multiple lights
-    FragColor = vec4(lighting, 1.0);
+	// -- Combine Lighting --
+#ifdef TEXTURED
+	vec3 albedo = texture(u_tex, tcoord).rgb * 1.5;
+#else
+	vec3 albedo = vec3(0.5, 0.5, 0.5) * 3.5;
+#endif
+
+	// Final Fragment Color
+	FragColor = vec4(all_lights() * albedo, 1.0);
 }
 
 // Extra practice: Add more information to light such as ambient-diffuse-specular + intensity
@@ -2,11 +2,21 @@
 
 in vec2 tcoord;
 
+#ifdef ATLAS
+flat in int layer;  // Of the TextureAtlas, whose region tcoord has already been remapped to
+
+uniform sampler2DArray u_tex;
+#else
 uniform sampler2D u_tex;
+#endif
 
 out vec4 FragColor;
 
 void main()
 {
+#ifdef ATLAS
+    FragColor = texture(u_tex, vec3(tcoord, layer));
+#else
     FragColor = texture(u_tex, tcoord);
+#endif
 }
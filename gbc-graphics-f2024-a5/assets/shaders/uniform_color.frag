@@ -2,9 +2,17 @@
 
 uniform vec3 u_color;
 
+#if defined(INSTANCED) || defined(POOLED)
+in vec3 color;  // Per-instance or per-draw tint, white unless DrawMeshInstanced was given colours
+#endif
+
 out vec4 FragColor;
 
 void main()
 {
+#if defined(INSTANCED) || defined(POOLED)
+    FragColor = vec4(u_color * color, 1.0);
+#else
     FragColor = vec4(u_color, 1.0);
+#endif
 }
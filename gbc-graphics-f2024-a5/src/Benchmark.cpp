@@ -0,0 +1,918 @@
+#include "Benchmark.h"
+#include "File.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "Texture.h"
+#include "TextureCache.h"
+#include "TextureCompressor.h"
+#include <par_shapes.h>
+#include <stb_image.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+using Clock = std::chrono::high_resolution_clock;
+
+double Milliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Checks that failed since startup. Counted rather than asserted so --selftest also fails in release builds
+static int gFailures = 0;
+
+static bool Check(bool passed, const char* what)
+{
+	if (!passed)
+	{
+		printf("**CHECK FAILED: %s**\n", what);
+		gFailures++;
+	}
+	return passed;
+}
+
+bool FileExists(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+	{
+		printf("Benchmark: %s not found, skipping\n", path);
+		return false;
+	}
+	fclose(file);
+	return true;
+}
+
+// Self tests run each benchmark just enough to cover its checks
+static void RunAll(bool selfTest)
+{
+	auto iterations = [selfTest](int count) { return selfTest ? 1 : count; };
+
+	const char* meshes[] =
+	{
+		"assets/meshes/head.obj",
+		"assets/meshes/ct4.obj",
+		"assets/meshes/cube.obj",
+		"assets/meshes/plane.obj"
+	};
+
+	printf("-- Math (" SIMD_BACKEND " vs scalar) --\n");
+	BenchmarkMath(selfTest ? 256 : 1000000);
+
+	printf("-- Batched transforms (per element loop vs batch) --\n");
+	BenchmarkBatchTransforms(4099, iterations(1000));
+
+	printf("-- Mesh load (text parse vs binary cache) --\n");
+	for (const char* path : meshes)
+		BenchmarkMeshLoad(path, iterations(10));
+
+	printf("-- Vertex quantization (worst round-trip error) --\n");
+	for (const char* path : meshes)
+		CheckQuantization(path);
+	CheckQuantization(PLANE);
+	CheckQuantization(CUBE);
+	CheckQuantization(SPHERE);
+
+	printf("-- Obj parse (fast_obj vs parallel) --\n");
+	for (const char* path : meshes)
+		BenchmarkObjParse(path, iterations(10));
+
+	printf("-- LOD generation --\n");
+	for (const char* path : meshes)
+		BenchmarkLods(path, iterations(10));
+	BenchmarkLods("subdivided sphere", SubdividedSphere(4), iterations(10));
+
+	printf("-- Meshlet culling --\n");
+	for (const char* path : meshes)
+		BenchmarkMeshletCulling(path, iterations(100));
+
+	printf("-- Mipmaps (scalar reference vs " SIMD_BACKEND ") --\n");
+	BenchmarkMipmaps("assets/textures/dice.png", iterations(10));
+
+	printf("-- Block compression --\n");
+	BenchmarkBlockCompression("assets/textures/dice.png", iterations(10));
+
+	// The app's own loader & cache are running when B is pressed, so this one only runs with --selftest
+	if (selfTest)
+	{
+		printf("-- Texture cache --\n");
+		CheckTextureCache("assets/textures/dice.png");
+	}
+}
+
+void RunBenchmarks()
+{
+	RunAll(false);
+}
+
+int RunSelfTests()
+{
+	int failures = gFailures;
+	RunAll(true);
+	failures = gFailures - failures;
+	printf("-- Self test: %s (%i failed checks) --\n", failures == 0 ? "passed" : "**FAILED**", failures);
+	return failures;
+}
+
+template<typename T>
+bool SameBytes(const std::vector<T>& a, const std::vector<T>& b)
+{
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+bool SameMesh(const Mesh& a, const Mesh& b)
+{
+	if (a.lods.size() != b.lods.size())
+		return false;
+	for (size_t i = 0; i < a.lods.size(); i++)
+	{
+		if (!SameBytes(a.lods[i].indices, b.lods[i].indices) || a.lods[i].rmsError != b.lods[i].rmsError)
+			return false;
+	}
+	return a.count == b.count &&
+		SameBytes(a.positions, b.positions) &&
+		SameBytes(a.normals, b.normals) &&
+		SameBytes(a.tcoords, b.tcoords) &&
+		SameBytes(a.indices, b.indices) &&
+		SameBytes(a.meshlets, b.meshlets);
+}
+
+void BenchmarkMeshLoad(const char* path, int iterations)
+{
+	if (!FileExists(path))
+		return;
+
+	Mesh mesh;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+		LoadObj(&mesh, path);
+	double parseMs = Milliseconds(start) / iterations;
+
+	// Cached like CreateMesh caches it, but from a scratch copy of the obj so the app's own cache is left alone
+	const char* scratchPath = "benchmark_mesh.obj";
+	std::string scratchCache = std::string(scratchPath) + ".cache";
+	std::vector<uint8_t> obj;
+	FILE* file = ReadFile(path, &obj) ? fopen(scratchPath, "wb") : nullptr;
+	bool copied = file != nullptr && fwrite(obj.data(), 1, obj.size(), file) == obj.size();
+	if (file != nullptr)
+		fclose(file);
+	if (!Check(copied, "scratch copy of the obj written"))
+		return;
+	OptimizeMesh(&mesh);
+	GenerateLods(&mesh, mesh.lodCount);
+	SaveMeshCache(mesh, scratchPath);
+
+	Mesh cached;
+	bool loaded = true;
+	start = Clock::now();
+	for (int i = 0; i < iterations && loaded; i++)
+		loaded = LoadMeshCache(&cached, scratchPath);
+	double cacheMs = Milliseconds(start) / iterations;
+	remove(scratchPath);
+	remove(scratchCache.c_str());
+	if (!Check(loaded, "mesh cache loads"))
+		return;
+	Check(SameMesh(mesh, cached), "mesh cache round trips the mesh");
+
+	printf("%-28s text parse %8.3f ms | binary cache %8.3f ms | %5.1fx faster\n", path, parseMs, cacheMs, parseMs / cacheMs);
+}
+
+static void CheckQuantization(const char* name, const Mesh& mesh)
+{
+	QuantizationError error = MeasureQuantizationError(mesh);
+	bool passed = error.position <= POSITION_TOLERANCE && error.normal <= NORMAL_TOLERANCE && error.tcoord <= TCOORD_TOLERANCE;
+	printf("%-28s position %f | normal %f (<= %f) | tcoord %f (<= %f) | %s\n", name, error.position,
+		error.normal, NORMAL_TOLERANCE, error.tcoord, TCOORD_TOLERANCE, passed ? "within tolerance" : "**OUT OF TOLERANCE**");
+	Check(passed, "packed vertices within the quantization tolerance");
+}
+
+void CheckQuantization(const char* path)
+{
+	if (!FileExists(path))
+		return;
+
+	Mesh mesh;
+	if (Check(LoadObj(&mesh, path), "mesh loads"))
+		CheckQuantization(path, mesh);
+}
+
+void CheckQuantization(ShapeType shape)
+{
+	const char* names[] = { "PLANE", "CUBE", "SPHERE" };
+	Mesh mesh;
+	CreateMesh(&mesh, shape);
+	CheckQuantization(names[shape], mesh);
+	DestroyMesh(&mesh);
+}
+
+void BenchmarkObjParse(const char* path, int iterations)
+{
+	if (!FileExists(path))
+		return;
+
+	Mesh reference;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+		LoadObjSerial(&reference, path);
+	double serialMs = Milliseconds(start) / iterations;
+	printf("%-28s fast_obj           %8.3f ms\n", path, serialMs);
+
+	int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		Mesh mesh;
+		start = Clock::now();
+		for (int i = 0; i < iterations; i++)
+			LoadObj(&mesh, path, threads);
+		double parallelMs = Milliseconds(start) / iterations;
+
+		bool identical = SameMesh(reference, mesh);
+		printf("%-28s parallel x%-2i       %8.3f ms | %5.2fx | %s\n", path, threads, parallelMs, serialMs / parallelMs,
+			identical ? "identical" : "**MISMATCH**");
+		Check(identical, "parallel obj parse matches fast_obj");
+	}
+}
+
+// Closest point to p on triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+static Vector3 ClosestPointTriangle(Vector3 p, Vector3 a, Vector3 b, Vector3 c)
+{
+	Vector3 ab = b - a, ac = c - a;
+	Vector3 ap = p - a;
+	float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		return a;
+
+	Vector3 bp = p - b;
+	float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+		return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		return a + ab * (d1 / (d1 - d3));
+
+	Vector3 cp = p - c;
+	float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+		return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		return a + ac * (d2 / (d2 - d6));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	float denominator = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// RMS & largest distance from the full mesh's vertices to a level's triangles, relative to the mesh's largest
+// dimension like SimplifyMesh's errors. Large meshes are sampled, every stride-th vertex
+static void MeasureLodDeviation(const Mesh& mesh, const std::vector<uint32_t>& indices, float* rms, float* largest)
+{
+	Vector3 size = mesh.boundsMax - mesh.boundsMin;
+	float extent = std::max(std::max(size.x, size.y), size.z);
+	float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+	size_t stride = std::max<size_t>(mesh.positions.size() / 2048, 1);
+	double squares = 0.0;
+	size_t samples = 0;
+	*largest = 0.0f;
+	for (size_t v = 0; v < mesh.positions.size(); v += stride)
+	{
+		Vector3 p = mesh.positions[v];
+		float nearest = INFINITY;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			Vector3 closest = ClosestPointTriangle(p, mesh.positions[indices[i]], mesh.positions[indices[i + 1]], mesh.positions[indices[i + 2]]);
+			nearest = std::min(nearest, Dot(p - closest, p - closest));
+		}
+		float distance = sqrtf(nearest) * scale;
+		squares += (double)distance * distance;
+		*largest = std::max(*largest, distance);
+		samples++;
+	}
+	*rms = samples > 0 ? (float)sqrt(squares / (double)samples) : 0.0f;
+}
+
+void BenchmarkLods(const char* path, int iterations)
+{
+	if (!FileExists(path))
+		return;
+
+	Mesh mesh;
+	if (Check(LoadObj(&mesh, path), "mesh loads"))
+		BenchmarkLods(path, mesh, iterations);
+}
+
+Mesh SubdividedSphere(int subdivisions)
+{
+	par_shapes_mesh* par = par_shapes_create_subdivided_sphere(subdivisions);
+	par_shapes_compute_normals(par);
+	Mesh mesh;
+	mesh.count = par->ntriangles * 3;
+	mesh.indices.assign(par->triangles, par->triangles + mesh.count);
+	mesh.positions.assign((const Vector3*)par->points, (const Vector3*)par->points + par->npoints);
+	mesh.normals.assign((const Vector3*)par->normals, (const Vector3*)par->normals + par->npoints);
+	par_shapes_free_mesh(par);
+	ComputeBounds(&mesh);
+	return mesh;
+}
+
+void BenchmarkLods(const char* name, const Mesh& parsed, int iterations)
+{
+	Mesh reference = parsed;
+	OptimizeMesh(&reference);
+	GenerateLods(&reference, reference.lodCount);
+
+	Mesh mesh = reference;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+		GenerateLods(&mesh, mesh.lodCount);
+	double ms = Milliseconds(start) / iterations;
+	printf("%-28s %zu triangles, %zu levels in %8.3f ms\n", name, mesh.indices.size() / 3, mesh.lods.size(), ms);
+
+	size_t previousCount = mesh.indices.size();
+	float previousError = 0.0f;
+	for (size_t level = 0; level < mesh.lods.size(); level++)
+	{
+		const MeshLod& lod = mesh.lods[level];
+		bool identical = SameBytes(lod.indices, reference.lods[level].indices) && lod.rmsError == reference.lods[level].rmsError;
+
+		bool valid = lod.indices.size() % 3 == 0 && lod.indices.size() < previousCount && lod.rmsError >= previousError;
+		for (size_t i = 0; i < lod.indices.size(); i += 3)
+		{
+			uint32_t a = lod.indices[i], b = lod.indices[i + 1], c = lod.indices[i + 2];
+			valid = valid && a < mesh.positions.size() && b < mesh.positions.size() && c < mesh.positions.size();
+			valid = valid && a != b && b != c && a != c;
+		}
+
+		// The simplifier's error is an average over its quadrics, so it's compared against the distance of the full mesh's
+		// vertices from the level's surface rather than trusted
+		float deviation, largest;
+		MeasureLodDeviation(mesh, lod.indices, &deviation, &largest);
+		bool bounded = lod.rmsError <= LOD_MAX_ERROR && deviation <= LOD_MAX_ERROR;
+
+		printf("%-28s LOD %zu %8zu triangles | RMS error %f, measured %f (largest %f) | %s | %s | %s\n", name, level + 1,
+			lod.indices.size() / 3, lod.rmsError, deviation, largest, valid ? "valid" : "**INVALID**",
+			bounded ? "within bound" : "**OVER BOUND**", identical ? "deterministic" : "**NON-DETERMINISTIC**");
+		Check(valid, "LOD has fewer valid triangles & no smaller error");
+		Check(bounded, "LOD's reported & measured RMS errors within LOD_MAX_ERROR");
+		Check(identical, "LOD generation is deterministic");
+		previousCount = lod.indices.size();
+		previousError = lod.rmsError;
+	}
+}
+
+// Whether the triangle is entirely outside one clip plane or wound clockwise (back-facing) from the camera
+bool TriangleCulled(Vector3 p0, Vector3 p1, Vector3 p2, Matrix mvp, Vector3 camera)
+{
+	if (Dot(Cross(p1 - p0, p2 - p0), p0 - camera) >= 0.0f)
+		return true;
+
+	Vector4 clip[3];
+	Vector3 points[3] = { p0, p1, p2 };
+	for (int i = 0; i < 3; i++)
+		clip[i] = mvp * Vector4{ points[i].x, points[i].y, points[i].z, 1.0f };
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		bool below = true, above = true;
+		for (int i = 0; i < 3; i++)
+		{
+			float value = axis == 0 ? clip[i].x : axis == 1 ? clip[i].y : clip[i].z;
+			below = below && value < -clip[i].w;
+			above = above && value > clip[i].w;
+		}
+		if (below || above)
+			return true;
+	}
+	return false;
+}
+
+void BenchmarkMeshletCulling(const char* path, int iterations)
+{
+	if (!FileExists(path))
+		return;
+
+	Mesh mesh;
+	LoadObj(&mesh, path);
+	OptimizeMesh(&mesh);
+
+	Vector3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+	float extent = Length(mesh.boundsMax - mesh.boundsMin);
+	Matrix world = MatrixIdentity();
+	Matrix proj = Perspective(75.0f * DEG2RAD, 16.0f / 9.0f, 0.01f, 100.0f * extent);
+	Vector3 directions[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 1, 1, 1 }, { -1, -1, 1 } };
+	float distances[] = { 0.4f, 1.5f };
+
+	int triangleCount = (int)mesh.indices.size() / 3;
+	long culled = 0, views = 0;
+	double ms = 0.0;
+	bool conservative = true;
+	std::vector<DrawElementsIndirectCommand> commands;
+	for (Vector3 direction : directions)
+	{
+		for (float distance : distances)
+		{
+			Vector3 camera = center + Normalize(direction) * extent * distance;
+			Matrix view = LookAt(camera, center, { 0.0f, 1.0f, 0.0f });
+			MeshletCullStats stats;
+
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < iterations; i++)
+			{
+				commands.clear();
+				stats = CullMeshlets(mesh, world, view, proj, &commands);
+			}
+			ms += Milliseconds(start) / iterations;
+
+			// Every triangle left out of the commands must be invisible
+			Matrix mvp = world * view * proj;
+			std::vector<bool> drawn(triangleCount, false);
+			for (const DrawElementsIndirectCommand& command : commands)
+				std::fill(drawn.begin() + command.firstIndex / 3, drawn.begin() + (command.firstIndex + command.count) / 3, true);
+			for (int t = 0; t < triangleCount; t++)
+			{
+				const uint32_t* triangle = &mesh.indices[t * 3];
+				if (!drawn[t] && !TriangleCulled(mesh.positions[triangle[0]], mesh.positions[triangle[1]], mesh.positions[triangle[2]], mvp, camera))
+					conservative = false;
+			}
+
+			culled += triangleCount - stats.triangles;
+			views++;
+		}
+	}
+
+	printf("%-28s %zu meshlets | %8.4f ms per cull | %5.1f%% of triangles culled | %s\n", path, mesh.meshlets.size(),
+		ms / views, 100.0 * culled / ((double)triangleCount * views), conservative ? "conservative" : "**VISIBLE TRIANGLES CULLED**");
+	Check(conservative, "meshlet culling never culls a visible triangle");
+}
+
+template<typename Op>
+double NanosecondsPerOp(int iterations, Op op)
+{
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+		op(i);
+	return Milliseconds(start) * 1000000.0 / iterations;
+}
+
+// Largest difference between two arrays of floats, relative to their magnitude
+float MaxError(const float* a, const float* b, size_t count)
+{
+	float error = 0.0f;
+	for (size_t i = 0; i < count; i++)
+		error = std::max(error, fabsf(a[i] - b[i]) / std::max(1.0f, fabsf(b[i])));
+	return error;
+}
+
+void PrintMathResult(const char* name, double scalarNs, double simdNs, float error)
+{
+	printf("%-16s scalar %7.2f ns | " SIMD_BACKEND " %7.2f ns | %5.2fx | max error %g\n", name, scalarNs, simdNs, scalarNs / simdNs, error);
+}
+
+void BenchmarkMath(int iterations)
+{
+	// Enough inputs that the loops can't be folded, few enough to stay in L1
+	const int count = 256;
+	std::vector<Matrix> matrices(count), results(count), references(count);
+	std::vector<Vector4> vectors(count), vectorResults(count), vectorReferences(count);
+	for (int i = 0; i < count; i++)
+	{
+		// Well-conditioned transforms like the ones we render with
+		matrices[i] = Scale(Random(0.5f, 2.0f), Random(0.5f, 2.0f), Random(0.5f, 2.0f)) *
+			RotateX(Random(-PI, PI)) * RotateY(Random(-PI, PI)) * Translate(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f));
+		vectors[i] = { Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f) };
+	}
+
+	const int mask = count - 1;
+	double scalarNs, simdNs;
+
+	scalarNs = NanosecondsPerOp(iterations, [&](int i) { references[i & mask] = MultiplyScalar(matrices[i & mask], matrices[(i + 1) & mask]); });
+	simdNs = NanosecondsPerOp(iterations, [&](int i) { results[i & mask] = Multiply(matrices[i & mask], matrices[(i + 1) & mask]); });
+	float error = MaxError(&results[0].m0, &references[0].m0, count * 16);
+	PrintMathResult("Multiply", scalarNs, simdNs, error);
+	Check(error == 0.0f, "SIMD Multiply matches scalar");
+
+	scalarNs = NanosecondsPerOp(iterations, [&](int i) { references[i & mask] = InvertScalar(matrices[i & mask]); });
+	simdNs = NanosecondsPerOp(iterations, [&](int i) { results[i & mask] = Invert(matrices[i & mask]); });
+	error = MaxError(&results[0].m0, &references[0].m0, count * 16);
+	PrintMathResult("Invert", scalarNs, simdNs, error);
+	Check(error < 1e-4f, "SIMD Invert matches scalar");
+
+	scalarNs = NanosecondsPerOp(iterations, [&](int i) { references[i & mask] = TransposeScalar(matrices[i & mask]); });
+	simdNs = NanosecondsPerOp(iterations, [&](int i) { results[i & mask] = Transpose(matrices[i & mask]); });
+	error = MaxError(&results[0].m0, &references[0].m0, count * 16);
+	PrintMathResult("Transpose", scalarNs, simdNs, error);
+	Check(error == 0.0f, "SIMD Transpose matches scalar");
+
+	scalarNs = NanosecondsPerOp(iterations, [&](int i) { vectorReferences[i & mask] = MultiplyScalar(vectors[i & mask], matrices[(i + 1) & mask]); });
+	simdNs = NanosecondsPerOp(iterations, [&](int i) { vectorResults[i & mask] = matrices[(i + 1) & mask] * vectors[i & mask]; });
+	error = MaxError(&vectorResults[0].x, &vectorReferences[0].x, count * 4);
+	PrintMathResult("Matrix * Vector4", scalarNs, simdNs, error);
+	Check(error == 0.0f, "SIMD Matrix * Vector4 matches scalar");
+}
+
+void PrintBatchResult(const char* name, double loopNs, double batchNs, float error)
+{
+	printf("%-24s loop %6.2f ns | batch %6.2f ns | %5.2fx | max error %g\n", name, loopNs, batchNs, loopNs / batchNs, error);
+}
+
+void BenchmarkBatchTransforms(int count, int iterations)
+{
+	struct Vertex
+	{
+		Vector3 position;
+		Vector3 normal;
+		Vector2 tcoord;
+	};
+
+	Matrix world = Scale(1.5f, 0.5f, 2.0f) * RotateY(0.7f) * Translate(1.0f, 2.0f, 3.0f);
+	Matrix viewProj = LookAt({ 0.0f, 5.0f, 10.0f }, V3_ZERO, V3_UP) * Perspective(75.0f * DEG2RAD, 1.0f, 0.1f, 100.0f);
+
+	std::vector<Vector3> points(count), results(count), references(count);
+	std::vector<float> xs(count), ys(count), zs(count);
+	std::vector<Vertex> vertices(count);
+	for (int i = 0; i < count; i++)
+	{
+		points[i] = { Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f) };
+		xs[i] = points[i].x;
+		ys[i] = points[i].y;
+		zs[i] = points[i].z;
+		vertices[i] = { points[i], Normalize(points[i]), V2_ZERO };
+	}
+
+	// Per element times so counts not a multiple of 4 (the scalar tail) compare fairly
+	auto perElement = [&](double ns) { return ns / count; };
+	double loopNs, batchNs;
+	float error;
+
+	loopNs = perElement(NanosecondsPerOp(iterations, [&](int) {
+		for (int i = 0; i < count; i++)
+			references[i] = Multiply(points[i], world);
+	}));
+	batchNs = perElement(NanosecondsPerOp(iterations, [&](int) { TransformPoints(world, ToSpan(points.data()), ToSpan(results.data()), count); }));
+	error = MaxError(&results[0].x, &references[0].x, count * 3);
+	PrintBatchResult("Points (Vector3 array)", loopNs, batchNs, error);
+	Check(error == 0.0f, "batched Points (Vector3 array) matches per element");
+
+	std::vector<float> rx(count), ry(count), rz(count);
+	batchNs = perElement(NanosecondsPerOp(iterations, [&](int) {
+		TransformPoints(world, ToSpan(xs.data(), ys.data(), zs.data()), ToSpan(rx.data(), ry.data(), rz.data()), count);
+	}));
+	for (int i = 0; i < count; i++)
+		results[i] = { rx[i], ry[i], rz[i] };
+	error = MaxError(&results[0].x, &references[0].x, count * 3);
+	PrintBatchResult("Points (x, y, z arrays)", loopNs, batchNs, error);
+	Check(error == 0.0f, "batched Points (x, y, z arrays) matches per element");
+
+	batchNs = perElement(NanosecondsPerOp(iterations, [&](int) {
+		TransformPoints(world, ToSpan(&vertices[0].position, sizeof(Vertex)), ToSpan(results.data()), count);
+	}));
+	error = MaxError(&results[0].x, &references[0].x, count * 3);
+	PrintBatchResult("Points (vertex positions)", loopNs, batchNs, error);
+	Check(error == 0.0f, "batched Points (vertex positions) matches per element");
+
+	std::vector<Matrix> worlds(count), mvps(count), mvpReferences(count);
+	for (int i = 0; i < count; i++)
+		worlds[i] = RotateY(Random(-PI, PI)) * Translate(Random(-10.0f, 10.0f), 0.0f, Random(-10.0f, 10.0f));
+	loopNs = perElement(NanosecondsPerOp(iterations, [&](int) {
+		for (int i = 0; i < count; i++)
+			mvpReferences[i] = worlds[i] * viewProj;
+	}));
+	batchNs = perElement(NanosecondsPerOp(iterations, [&](int) { MultiplyMatrices(worlds.data(), viewProj, mvps.data(), count); }));
+	error = MaxError(&mvps[0].m0, &mvpReferences[0].m0, count * 16);
+	PrintBatchResult("World * view-projection", loopNs, batchNs, error);
+	Check(error == 0.0f, "batched World * view-projection matches per element");
+}
+
+void BenchmarkMipmaps(const char* path, int iterations)
+{
+	if (!FileExists(path))
+		return;
+
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(path, &width, &height, &channels, STBI_rgb_alpha);
+	if (!Check(pixels != nullptr, "benchmark image decodes"))
+		return;
+
+	std::vector<uint8_t> chain, reference;
+	std::vector<MipLevel> levels, referenceLevels;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+		GenerateMipmapsScalar(pixels, width, height, &reference, &referenceLevels);
+	double scalarMs = Milliseconds(start) / iterations;
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+		GenerateMipmaps(pixels, width, height, &chain, &levels);
+	double simdMs = Milliseconds(start) / iterations;
+
+	// A 1x1 image has no levels below its base to compare
+	bool complete = Check(levels.size() == referenceLevels.size() && chain.size() == reference.size() &&
+		(int)levels.size() == MipCount(width, height) - 1, "mip chain reaches 1x1");
+	if (!Check(!levels.empty(), "benchmark image is bigger than 1x1") || !complete)
+	{
+		stbi_image_free(pixels);
+		return;
+	}
+
+	// Largest difference in any channel, per level
+	int error = 0;
+	for (size_t i = 0; i < chain.size(); i++)
+		error = std::max(error, abs(chain[i] - reference[i]));
+
+	// What averaging the sRGB bytes directly (as glGenerateMipmap does on RGBA8) gets wrong, for the first level
+	const MipLevel& first = levels[0];
+	int gammaError = 0;
+	for (int y = 0; y < first.height; y++)
+	{
+		for (int x = 0; x < first.width; x++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+				int sum = pixels[(y0 * width + x0) * 4 + c] + pixels[(y0 * width + x1) * 4 + c] +
+					pixels[(y1 * width + x0) * 4 + c] + pixels[(y1 * width + x1) * 4 + c];
+				int average = (sum + 2) / 4;
+				gammaError = std::max(gammaError, abs(average - reference[(y * first.width + x) * 4 + c]));
+			}
+		}
+	}
+	stbi_image_free(pixels);
+
+	printf("%-28s %ix%i, %zu levels | scalar %7.3f ms | " SIMD_BACKEND " %7.3f ms | %5.2fx | max error %i (gamma space average: %i)\n",
+		path, width, height, levels.size(), scalarMs, simdMs, scalarMs / simdMs, error, gammaError);
+	Check(error <= 1, "SIMD mips within 1 of the reference");
+}
+
+void BenchmarkBlockCompression(const char* path, int iterations)
+{
+	if (!FileExists(path))
+		return;
+
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(path, &width, &height, &channels, STBI_rgb_alpha);
+	if (!Check(pixels != nullptr, "benchmark image decodes"))
+		return;
+
+	const BlockFormat formats[] = { BLOCK_BC1, BLOCK_BC3 };
+	for (BlockFormat format : formats)
+	{
+		std::vector<uint8_t> blocks(CompressedSize(format, width, height));
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < iterations; i++)
+			CompressImage(pixels, width, height, format, blocks.data());
+		double encodeMs = Milliseconds(start) / iterations;
+
+		// BC1 has no alpha, so only colour is compared
+		std::vector<uint8_t> decoded(width * height * 4);
+		DecompressImage(blocks.data(), width, height, format, decoded.data());
+		int channelCount = format == BLOCK_BC1 ? 3 : 4;
+		int error = 0;
+		double squares = 0.0;
+		for (int i = 0; i < width * height; i++)
+		{
+			for (int c = 0; c < channelCount; c++)
+			{
+				int difference = abs(decoded[i * 4 + c] - pixels[i * 4 + c]);
+				error = std::max(error, difference);
+				squares += difference * difference;
+			}
+		}
+		double rmse = sqrt(squares / (width * height * channelCount));
+
+		double megapixels = width * height / 1000000.0;
+		printf("%-28s %s %ix%i | %7.3f ms (%6.1f MP/s) | %4.1f:1 vs RGBA8 | RMSE %5.2f | max error %i\n", path,
+			format == BLOCK_BC1 ? "BC1" : "BC3", width, height, encodeMs, megapixels / (encodeMs / 1000.0),
+			(width * height * 4.0) / (double)blocks.size(), rmse, error);
+
+		// A wrong index order or endpoint swap shows up as errors many times this
+		Check(rmse < 16.0, "block compression RMSE under 16");
+	}
+	stbi_image_free(pixels);
+}
+
+// An uncompressed 32-bit TGA (which stb_image reads), so the cache check can load images that aren't in the assets
+static bool WriteTga(const char* path, const std::vector<uint8_t>& pixels, int width, int height)
+{
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr)
+		return false;
+
+	uint8_t header[18] = {};
+	header[2] = 2;		// Uncompressed true colour
+	header[12] = width & 0xFF;
+	header[13] = width >> 8;
+	header[14] = height & 0xFF;
+	header[15] = height >> 8;
+	header[16] = 32;
+	header[17] = 8;		// Alpha bits, bottom row first
+	std::vector<uint8_t> bgra = pixels;
+	for (size_t i = 0; i < bgra.size(); i += 4)
+		std::swap(bgra[i], bgra[i + 2]);
+	bool written = fwrite(header, sizeof(header), 1, file) == 1 && fwrite(bgra.data(), bgra.size(), 1, file) == 1;
+	fclose(file);
+	return written;
+}
+
+// One frame of the loader & cache with only these textures drawn
+static void CacheFrame(std::initializer_list<Texture*> used)
+{
+	UpdateTextures();
+	for (Texture* texture : used)
+		UseTexture(texture);
+	UpdateTextureCache();
+}
+
+// Runs frames until the textures are loaded with every level, or 5 seconds pass
+static bool SettleTextures(std::initializer_list<Texture*> used)
+{
+	for (int frame = 0; frame < 1000; frame++)
+	{
+		CacheFrame(used);
+		bool settled = true;
+		for (Texture* texture : used)
+			settled &= texture->loaded && texture->dropped == 0;
+		if (settled)
+			return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return false;
+}
+
+static const CachedTexture* FindCached(const char* path)
+{
+	for (const CachedTexture* cached : CachedTextures())
+	{
+		if (cached->texture.path == path)
+			return cached;
+	}
+	return nullptr;
+}
+
+// A level as it's stored on the GPU, blocks or RGBA8 pixels
+static std::vector<uint8_t> ReadLevel(const Texture& texture, int level)
+{
+	std::vector<uint8_t> bytes;
+	if (texture.format == GL_RGBA8)
+	{
+		int width = std::max(texture.width >> (texture.dropped + level), 1);
+		int height = std::max(texture.height >> (texture.dropped + level), 1);
+		bytes.resize((size_t)width * height * 4);
+		glGetTextureImage(texture.id, level, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)bytes.size(), bytes.data());
+		return bytes;
+	}
+
+	GLint size = 0;
+	glGetTextureLevelParameteriv(texture.id, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+	bytes.resize(size);
+	glGetCompressedTextureImage(texture.id, level, size, bytes.data());
+	return bytes;
+}
+
+// Checks DropTopMip frees the top level's bytes & copies the rest across unchanged
+static void CheckDropTopMip(Texture* texture)
+{
+	int width = std::max(texture->width >> texture->dropped, 1);
+	int height = std::max(texture->height >> texture->dropped, 1);
+	size_t top = (size_t)width * height * 4;
+	if (texture->format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+		top = CompressedSize(BLOCK_BC1, width, height);
+	if (texture->format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+		top = CompressedSize(BLOCK_BC3, width, height);
+
+	std::vector<uint8_t> second = ReadLevel(*texture, 1);
+	size_t bytes = TextureBytes(*texture);
+	int levels = texture->levels;
+	bool dropped = DropTopMip(texture);
+	printf("%-28s %ix%i, %i levels, %zu KB | DropTopMip frees %zu KB\n", texture->path.c_str(), width, height, levels,
+		bytes / 1024, (bytes - TextureBytes(*texture)) / 1024);
+	Check(dropped && texture->levels == levels - 1 && TextureBytes(*texture) == bytes - top, "DropTopMip frees exactly the top level");
+	Check(ReadLevel(*texture, 0) == second, "DropTopMip copies the remaining levels unchanged");
+}
+
+void CheckTextureCache(const char* path)
+{
+	if (!FileExists(path))
+		return;
+
+	// Beside path's image: an opaque one & one with alpha, so both block formats are covered
+	const char* opaquePath = "selftest_opaque.tga";
+	const char* alphaPath = "selftest_alpha.tga";
+	std::vector<uint8_t> opaque(128 * 128 * 4), alpha(256 * 256 * 4);
+	for (int y = 0; y < 128; y++)
+	{
+		for (int x = 0; x < 128; x++)
+		{
+			uint8_t* pixel = &opaque[(y * 128 + x) * 4];
+			pixel[0] = x * 2;
+			pixel[1] = y * 2;
+			pixel[2] = 128;
+			pixel[3] = 255;
+		}
+	}
+	for (int y = 0; y < 256; y++)
+	{
+		for (int x = 0; x < 256; x++)
+		{
+			uint8_t* pixel = &alpha[(y * 256 + x) * 4];
+			pixel[0] = x;
+			pixel[1] = y;
+			pixel[2] = x ^ y;
+			pixel[3] = (x + y) / 2;
+		}
+	}
+	if (!Check(WriteTga(opaquePath, opaque, 128, 128) && WriteTga(alphaPath, alpha, 256, 256), "cache check images written"))
+		return;
+
+	while (glGetError() != GL_NO_ERROR);
+	CreateTextureLoader();
+	CreateTextureCache();
+	size_t budget = gTextureCacheStats.budgetBytes;
+
+	Texture* image = AcquireTexture(path);
+	Texture* opaqueTexture = AcquireTexture(opaquePath);
+	Texture* alphaTexture = AcquireTexture(alphaPath);
+	Check(AcquireTexture(path) == image, "acquiring a path again shares its texture");
+	ReleaseTexture(image);
+	if (Check(SettleTextures({ image, opaqueTexture, alphaTexture }), "cached textures load"))
+	{
+		if (image->format != GL_RGBA8)
+			Check(opaqueTexture->format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT && alphaTexture->format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+				"opaque images load as BC1 & ones with alpha as BC3");
+		else
+			printf("Texture cache: no S3TC, checking RGBA8 textures\n");
+
+		// Released & last used in this order, so they're evicted in it as the budget shrinks
+		size_t opaqueBytes = TextureBytes(*opaqueTexture);
+		size_t alphaBytes = TextureBytes(*alphaTexture);
+		CacheFrame({ image, opaqueTexture, alphaTexture });
+		CacheFrame({ opaqueTexture, alphaTexture });
+		ReleaseTexture(image);
+		ReleaseTexture(opaqueTexture);
+		ReleaseTexture(alphaTexture);
+		gTextureCacheStats.budgetBytes = opaqueBytes + alphaBytes;
+		CacheFrame({ alphaTexture });
+		Check(gTextureCacheStats.evicted == 1 && FindCached(path) == nullptr && FindCached(opaquePath) != nullptr,
+			"the least recently used texture is evicted first");
+		gTextureCacheStats.budgetBytes = alphaBytes;
+		CacheFrame({ alphaTexture });
+		Check(gTextureCacheStats.evicted == 2 && FindCached(opaquePath) == nullptr && FindCached(alphaPath) != nullptr &&
+			gTextureCacheStats.residentBytes == alphaBytes, "eviction stops once the cache fits its budget");
+
+		// Acquired again, the evicted images come back from their baked caches
+		gTextureCacheStats.budgetBytes = budget;
+		image = AcquireTexture(path);
+		opaqueTexture = AcquireTexture(opaquePath);
+		alphaTexture = AcquireTexture(alphaPath);
+		if (Check(SettleTextures({ image, opaqueTexture, alphaTexture }), "evicted textures load again"))
+		{
+			CheckDropTopMip(opaqueTexture);
+			CheckDropTopMip(alphaTexture);
+			Check(SettleTextures({ image, opaqueTexture, alphaTexture }) && gTextureCacheStats.reloaded == 2,
+				"textures that dropped mips reload at full size once they fit");
+
+			// Memory the cache doesn't own (like an atlas) takes room from its textures. Those still acquired shrink rather
+			// than go, & only the ones not drawn this frame
+			size_t cached = TextureBytes(*image) + TextureBytes(*opaqueTexture) + TextureBytes(*alphaTexture);
+			gTextureCacheStats.budgetBytes = cached;
+			TrackTextureBytes(&cached, 1);
+			CacheFrame({ image, opaqueTexture });
+			Check(image->dropped == 0 && opaqueTexture->dropped == 0 && alphaTexture->dropped == 1 && gTextureCacheStats.dropped == 1 &&
+				gTextureCacheStats.trackedBytes == 1, "over budget, acquired textures not drawn drop their top mip");
+			TrackTextureBytes(&cached, 0);
+
+			// A reload that can't find its image any more keeps the smaller version & isn't retried
+			remove(alphaPath);
+			remove((std::string(alphaPath) + ".cache").c_str());
+			gTextureCacheStats.budgetBytes = budget;
+			for (int frame = 0; frame < 1000 && !alphaTexture->failed; frame++)
+			{
+				CacheFrame({ image, opaqueTexture, alphaTexture });
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+			CacheFrame({ image, opaqueTexture, alphaTexture });
+			Check(alphaTexture->failed && alphaTexture->loaded && alphaTexture->dropped == 1 && !FindCached(alphaPath)->reloading &&
+				gTextureCacheStats.reloaded == 3, "a failed reload keeps the smaller texture & isn't retried");
+		}
+		ReleaseTexture(image);
+		ReleaseTexture(opaqueTexture);
+		ReleaseTexture(alphaTexture);
+	}
+
+	DestroyTextureCache();
+	DestroyTextureLoader();
+	remove(opaquePath);
+	remove(alphaPath);
+	remove((std::string(opaquePath) + ".cache").c_str());
+	remove((std::string(alphaPath) + ".cache").c_str());
+	Check(glGetError() == GL_NO_ERROR, "texture cache leaves no GL errors");
+}
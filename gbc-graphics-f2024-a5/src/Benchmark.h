@@ -0,0 +1,56 @@
+#pragma once
+#include "Mesh.h"
+
+// Console timing harnesses. Press B in the app to run them all.
+void RunBenchmarks();
+
+// Runs every benchmark once, just for its checks, & returns how many checks failed. Run with --selftest
+int RunSelfTests();
+
+// Average time to parse the obj at path as text vs loading its binary cache
+void BenchmarkMeshLoad(const char* path, int iterations);
+
+// Checks packing the obj at path's or the shape's vertices & unpacking them again stays within the quantization
+// tolerances (Mesh.h). Shapes are uploaded, so they need a GL context
+void CheckQuantization(const char* path);
+void CheckQuantization(ShapeType shape);
+
+// Single-threaded fast_obj parse vs the chunked parallel parser at increasing thread counts.
+// Also checks that every thread count builds a mesh byte-identical to fast_obj's.
+void BenchmarkObjParse(const char* path, int iterations);
+
+// Time to generate LODs, and checks each level has fewer triangles, no smaller RMS error & no degenerate
+// triangles than the last, and that generating twice gives identical levels. Also checks each level's reported
+// RMS error & the measured RMS distance of the full mesh's vertices from its surface are within LOD_MAX_ERROR.
+// The Mesh version takes an unoptimized mesh, like the ones LoadObj builds
+void BenchmarkLods(const char* path, int iterations);
+void BenchmarkLods(const char* name, const Mesh& parsed, int iterations);
+
+// A sphere of 20 * 4^subdivisions triangles, for benchmarks that need a smooth, detailed mesh without an asset
+Mesh SubdividedSphere(int subdivisions);
+
+// Time to cull a mesh's meshlets from cameras around it, and checks by brute force that every culled triangle
+// really is outside the frustum or facing away from the camera
+void BenchmarkMeshletCulling(const char* path, int iterations);
+
+// Nanoseconds per call of Math.h's SIMD Multiply, Invert, Transpose & Matrix * Vector4 vs their scalar
+// reference versions. Also checks both give the same results
+void BenchmarkMath(int iterations);
+
+// Nanoseconds per element of Math.h's batched transforms vs calling the single element versions in a loop: points in
+// a Vector3 array, separate x/y/z arrays & interleaved in vertices, then world * view-projection matrices.
+// Also checks both give the same results
+void BenchmarkBatchTransforms(int count, int iterations);
+
+// Time to build an image's mip chain with Texture.cpp's SIMD downsampler vs its scalar reference. Checks every level
+// is within 1 of the reference & reports how far averaging in gamma space (like glGenerateMipmap) is from it
+void BenchmarkMipmaps(const char* path, int iterations);
+
+// Time to compress an image to BC1 & BC3, & how far decoding the blocks again is from the original
+void BenchmarkBlockCompression(const char* path, int iterations);
+
+// Loads path's image & two generated ones through a texture cache with a shrinking budget. Checks they're evicted least
+// recently used first, that DropTopMip frees a level & copies the rest (BC1 & BC3 with S3TC), that tracked bytes make
+// textures shrink & that dropped mips reload once they fit. Creates its own texture loader & cache, so it can't run
+// while the app's are
+void CheckTextureCache(const char* path);
@@ -0,0 +1,201 @@
+#include "File.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+bool ReadFile(const char* path, std::vector<uint8_t>* bytes)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	bytes->resize(size);
+	size_t read = fread(bytes->data(), 1, size, file);
+	fclose(file);
+	return read == (size_t)size;
+}
+
+uint64_t HashBytes(const void* bytes, size_t size, uint64_t hash)
+{
+	const uint8_t* data = (const uint8_t*)bytes;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+uint64_t HashFile(const char* path)
+{
+	std::vector<uint8_t> bytes;
+	if (!ReadFile(path, &bytes))
+		return 0;
+	return HashBytes(bytes.data(), bytes.size());
+}
+
+// How often the watcher thread checks whether it should stop
+constexpr int WATCH_TIMEOUT_MS = 100;
+
+struct DirectoryWatcher
+{
+	std::thread thread;
+	std::atomic<bool> running;
+	std::mutex mutex;
+	std::vector<std::string> changed;	// Guarded by mutex
+
+#if defined(_WIN32)
+	HANDLE directory = INVALID_HANDLE_VALUE;
+#else
+	int fd = -1;
+#endif
+};
+
+static void AddChange(DirectoryWatcher* watcher, std::string name)
+{
+	std::lock_guard<std::mutex> lock(watcher->mutex);
+	if (std::find(watcher->changed.begin(), watcher->changed.end(), name) == watcher->changed.end())
+		watcher->changed.push_back(std::move(name));
+}
+
+#if defined(_WIN32)
+static void WatchDirectory(DirectoryWatcher* watcher)
+{
+	OVERLAPPED overlapped{};
+	overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	alignas(DWORD) char buffer[4096];
+	const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+
+	bool queued = false;
+	while (watcher->running)
+	{
+		if (!queued)
+		{
+			if (!ReadDirectoryChangesW(watcher->directory, buffer, sizeof(buffer), FALSE, filter, NULL, &overlapped, NULL))
+				break;
+			queued = true;
+		}
+
+		if (WaitForSingleObject(overlapped.hEvent, WATCH_TIMEOUT_MS) != WAIT_OBJECT_0)
+			continue;
+
+		DWORD size = 0;
+		GetOverlappedResult(watcher->directory, &overlapped, &size, FALSE);
+		ResetEvent(overlapped.hEvent);
+		queued = false;
+
+		// 0 bytes means the buffer overflowed & the changes were lost
+		for (DWORD offset = 0; size > 0;)
+		{
+			const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)(buffer + offset);
+			if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED ||
+				info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+			{
+				int wideLength = info->FileNameLength / sizeof(WCHAR);
+				int length = WideCharToMultiByte(CP_UTF8, 0, info->FileName, wideLength, NULL, 0, NULL, NULL);
+				std::string name(length, '\0');
+				WideCharToMultiByte(CP_UTF8, 0, info->FileName, wideLength, &name[0], length, NULL, NULL);
+				AddChange(watcher, std::move(name));
+			}
+
+			if (info->NextEntryOffset == 0)
+				break;
+			offset += info->NextEntryOffset;
+		}
+	}
+
+	// The read must be cancelled before its buffer goes out of scope
+	if (queued)
+	{
+		DWORD size = 0;
+		CancelIoEx(watcher->directory, &overlapped);
+		GetOverlappedResult(watcher->directory, &overlapped, &size, TRUE);
+	}
+	CloseHandle(overlapped.hEvent);
+}
+#else
+static void WatchDirectory(DirectoryWatcher* watcher)
+{
+	alignas(inotify_event) char buffer[4096];
+	while (watcher->running)
+	{
+		pollfd fd{ watcher->fd, POLLIN, 0 };
+		if (poll(&fd, 1, WATCH_TIMEOUT_MS) <= 0)
+			continue;
+
+		ssize_t size = read(watcher->fd, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < size;)
+		{
+			const inotify_event* event = (const inotify_event*)(buffer + offset);
+			if (event->len > 0)
+				AddChange(watcher, event->name);
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+}
+#endif
+
+DirectoryWatcher* CreateDirectoryWatcher(const char* path)
+{
+	DirectoryWatcher* watcher = new DirectoryWatcher;
+#if defined(_WIN32)
+	watcher->directory = CreateFileA(path, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+	bool opened = watcher->directory != INVALID_HANDLE_VALUE;
+#else
+	// Editors either rewrite the file in place or write a temporary & rename it over the original
+	watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	bool opened = watcher->fd != -1 && inotify_add_watch(watcher->fd, path, IN_CLOSE_WRITE | IN_MOVED_TO) != -1;
+#endif
+	if (!opened)
+	{
+		printf("**Warning: could not watch directory %s**\n", path);
+		DestroyDirectoryWatcher(watcher);
+		return nullptr;
+	}
+
+	watcher->running = true;
+	watcher->thread = std::thread(WatchDirectory, watcher);
+	return watcher;
+}
+
+void DestroyDirectoryWatcher(DirectoryWatcher* watcher)
+{
+	if (watcher == nullptr)
+		return;
+
+	watcher->running = false;
+	if (watcher->thread.joinable())
+		watcher->thread.join();
+#if defined(_WIN32)
+	if (watcher->directory != INVALID_HANDLE_VALUE)
+		CloseHandle(watcher->directory);
+#else
+	if (watcher->fd != -1)
+		close(watcher->fd);
+#endif
+	delete watcher;
+}
+
+std::vector<std::string> PollDirectoryWatcher(DirectoryWatcher* watcher)
+{
+	std::vector<std::string> changed;
+	std::lock_guard<std::mutex> lock(watcher->mutex);
+	changed.swap(watcher->changed);
+	return changed;
+}
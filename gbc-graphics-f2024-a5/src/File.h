@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Starting value of HashBytes
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+// Reads the whole file at path. Returns false if it can't be opened or read
+bool ReadFile(const char* path, std::vector<uint8_t>* bytes);
+
+// FNV-1a hash of size bytes. Pass the previous result as hash to hash several buffers as one
+uint64_t HashBytes(const void* bytes, size_t size, uint64_t hash = FNV_OFFSET_BASIS);
+
+// Hash of the file at path, 0 if it can't be read
+uint64_t HashFile(const char* path);
+
+// Watches a directory (not its subdirectories) for written, created or renamed-in files on a background thread.
+// Uses inotify on Linux & ReadDirectoryChangesW on Windows
+struct DirectoryWatcher;
+
+// nullptr if the directory can't be watched
+DirectoryWatcher* CreateDirectoryWatcher(const char* path);
+void DestroyDirectoryWatcher(DirectoryWatcher* watcher);
+
+// Names (relative to the directory, without duplicates) of the files changed since the last call
+std::vector<std::string> PollDirectoryWatcher(DirectoryWatcher* watcher);
@@ -0,0 +1,142 @@
+#include "GLState.h"
+#include <cassert>
+#include <cstdint>
+
+// Value of state that isn't known, so every call changes it
+constexpr uint64_t UNKNOWN = ~0ull;
+
+// Starts as a new context's defaults
+struct GLStateShadow
+{
+	uint64_t program = GL_NONE;
+	uint64_t vao = GL_NONE;
+	uint64_t textures[MAX_TEXTURE_UNITS] = {};
+	uint64_t polygonMode = GL_FILL;
+	uint64_t depthTest = false;
+	uint64_t depthWrite = true;
+	uint64_t depthFunc = GL_LESS;
+	uint64_t blend = false;
+	uint64_t blendFunc = (uint64_t)GL_ONE << 32 | GL_ZERO;
+};
+
+GLStateStats gStateStats;
+static GLStateShadow gState;
+
+// Whether setting *shadow to value would change it. Remembers value if so
+static bool Changed(uint64_t* shadow, uint64_t value)
+{
+	if (*shadow == value)
+	{
+		gStateStats.filtered++;
+		return false;
+	}
+
+	*shadow = value;
+	gStateStats.issued++;
+	return true;
+}
+
+void BindProgram(GLuint program)
+{
+	if (Changed(&gState.program, program))
+		glUseProgram(program);
+}
+
+void BindVertexArray(GLuint vao)
+{
+	if (Changed(&gState.vao, vao))
+		glBindVertexArray(vao);
+}
+
+void BindTexture(GLuint unit, GLuint texture)
+{
+	assert(unit < MAX_TEXTURE_UNITS);
+	if (Changed(&gState.textures[unit], texture))
+		glBindTextureUnit(unit, texture);
+}
+
+void SetPolygonMode(GLenum mode)
+{
+	if (Changed(&gState.polygonMode, mode))
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void SetDepthTest(bool enabled)
+{
+	if (Changed(&gState.depthTest, enabled))
+	{
+		if (enabled)
+			glEnable(GL_DEPTH_TEST);
+		else
+			glDisable(GL_DEPTH_TEST);
+	}
+}
+
+void SetDepthWrite(bool enabled)
+{
+	if (Changed(&gState.depthWrite, enabled))
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void SetDepthFunc(GLenum func)
+{
+	if (Changed(&gState.depthFunc, func))
+		glDepthFunc(func);
+}
+
+void SetBlend(bool enabled)
+{
+	if (Changed(&gState.blend, enabled))
+	{
+		if (enabled)
+			glEnable(GL_BLEND);
+		else
+			glDisable(GL_BLEND);
+	}
+}
+
+void SetBlendFunc(GLenum src, GLenum dst)
+{
+	if (Changed(&gState.blendFunc, (uint64_t)src << 32 | dst))
+		glBlendFunc(src, dst);
+}
+
+void ForgetProgram(GLuint program)
+{
+	if (gState.program == program)
+		gState.program = UNKNOWN;
+}
+
+void ForgetVertexArray(GLuint vao)
+{
+	if (gState.vao == vao)
+		gState.vao = UNKNOWN;
+}
+
+void ForgetTexture(GLuint texture)
+{
+	for (uint64_t& bound : gState.textures)
+	{
+		if (bound == texture)
+			bound = UNKNOWN;
+	}
+}
+
+void InvalidateGLState()
+{
+	gState.program = UNKNOWN;
+	gState.vao = UNKNOWN;
+	for (uint64_t& texture : gState.textures)
+		texture = UNKNOWN;
+	gState.polygonMode = UNKNOWN;
+	gState.depthTest = UNKNOWN;
+	gState.depthWrite = UNKNOWN;
+	gState.depthFunc = UNKNOWN;
+	gState.blend = UNKNOWN;
+	gState.blendFunc = UNKNOWN;
+}
+
+void ResetGLStateStats()
+{
+	gStateStats = GLStateStats{};
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <glad/glad.h>
+
+// Shadows the GL state the renderer changes so calls that wouldn't change anything are never issued.
+// State changed with raw GL calls must be followed by InvalidateGLState
+
+// Texture units BindTexture tracks
+constexpr GLuint MAX_TEXTURE_UNITS = 16;
+
+// State calls since the last ResetGLStateStats
+struct GLStateStats
+{
+	int issued = 0;		// Made it to the driver
+	int filtered = 0;	// Skipped because the state already had that value
+};
+
+extern GLStateStats gStateStats;
+
+void BindProgram(GLuint program);
+void BindVertexArray(GLuint vao);
+void BindTexture(GLuint unit, GLuint texture);	// glBindTextureUnit, so texture must have been bound to a target once
+void SetPolygonMode(GLenum mode);				// Front & back faces
+void SetDepthTest(bool enabled);
+void SetDepthWrite(bool enabled);
+void SetDepthFunc(GLenum func);
+void SetBlend(bool enabled);
+void SetBlendFunc(GLenum src, GLenum dst);
+
+// Call before deleting a bound object, so a new object that reuses its name isn't taken as already bound
+void ForgetProgram(GLuint program);
+void ForgetVertexArray(GLuint vao);
+void ForgetTexture(GLuint texture);
+
+// The next call to each function is issued whatever the shadowed state says
+void InvalidateGLState();
+
+void ResetGLStateStats();
@@ -0,0 +1,126 @@
+#include "GeometryPool.h"
+#include "GLState.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+
+void CreateGeometryPool(GeometryPool* pool, GLuint vertexCapacity, GLuint indexCapacity)
+{
+	glGenVertexArrays(1, &pool->vao);
+	BindVertexArray(pool->vao);
+
+	// Same layout as a VERTEX_PACKED mesh, so every pooled mesh shares the attributes
+	glGenBuffers(1, &pool->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, pool->vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(PackedVertex), nullptr, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tcoord));
+	glEnableVertexAttribArray(2);
+
+	glGenBuffers(1, &pool->ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+
+	// Sized by each pass's draws
+	glGenBuffers(1, &pool->dbo);
+	glGenBuffers(1, &pool->sbo);
+
+	BindVertexArray(GL_NONE);
+	glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_NONE);
+
+	pool->vertexCapacity = vertexCapacity;
+	pool->indexCapacity = indexCapacity;
+	pool->vertexCount = 0;
+	pool->indexCount = 0;
+}
+
+void DestroyGeometryPool(GeometryPool* pool)
+{
+	glDeleteBuffers(1, &pool->sbo);
+	glDeleteBuffers(1, &pool->dbo);
+	glDeleteBuffers(1, &pool->ebo);
+	glDeleteBuffers(1, &pool->vbo);
+	ForgetVertexArray(pool->vao);
+	glDeleteVertexArrays(1, &pool->vao);
+
+	pool->vao = pool->vbo = pool->ebo = pool->dbo = pool->sbo = GL_NONE;
+	pool->vertexCount = pool->indexCount = 0;
+	pool->commands.clear();
+	pool->draws.clear();
+}
+
+PoolMesh AddToPool(GeometryPool* pool, const Mesh& mesh)
+{
+	std::vector<PackedVertex> vertices = PackVertices(mesh);
+
+	// Unindexed meshes draw their vertices in order
+	std::vector<uint32_t> indices = mesh.indices;
+	if (indices.empty())
+	{
+		indices.resize(vertices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+			indices[i] = (uint32_t)i;
+	}
+
+	// Every level's indices follow the full mesh's, like in a mesh's own element buffer
+	PoolMesh result;
+	result.baseVertex = pool->vertexCount;
+	result.levels.push_back({ pool->indexCount, (GLuint)indices.size() });
+	for (const MeshLod& lod : mesh.lods)
+	{
+		result.levels.push_back({ pool->indexCount + (GLuint)indices.size(), (GLuint)lod.indices.size() });
+		indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+	}
+
+	if (pool->vertexCount + vertices.size() > pool->vertexCapacity || pool->indexCount + indices.size() > pool->indexCapacity)
+	{
+		printf("Geometry pool full: %zu vertices & %zu indices don't fit in %u & %u free\n", vertices.size(), indices.size(),
+			pool->vertexCapacity - pool->vertexCount, pool->indexCapacity - pool->indexCount);
+		assert(false);
+		return PoolMesh{};
+	}
+
+	// Indices stay relative to the mesh. Each draw's baseVertex offsets them
+	glBindBuffer(GL_ARRAY_BUFFER, pool->vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, pool->vertexCount * sizeof(PackedVertex), vertices.size() * sizeof(PackedVertex), vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pool->ebo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, pool->indexCount * sizeof(uint32_t), indices.size() * sizeof(uint32_t), indices.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
+
+	pool->vertexCount += (GLuint)vertices.size();
+	pool->indexCount += (GLuint)indices.size();
+	return result;
+}
+
+void SubmitPoolDraw(GeometryPool* pool, const PoolMesh& mesh, int level, Matrix world, Matrix normal, Vector3 color,
+	const AtlasRegion& region)
+{
+	const PoolRange& range = mesh.levels[level];
+	pool->commands.push_back({ range.count, 1, range.firstIndex, mesh.baseVertex, 0 });
+	pool->draws.push_back({ world, normal, { color.x, color.y, color.z, 1.0f }, region.rect, region.layer });
+}
+
+void DrawGeometryPool(GeometryPool* pool)
+{
+	if (pool->commands.empty())
+		return;
+
+	// Reallocated every pass so the driver never waits on the last one's draws
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pool->dbo);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, pool->commands.size() * sizeof(DrawElementsIndirectCommand), pool->commands.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, pool->sbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, pool->draws.size() * sizeof(PoolDraw), pool->draws.data(), GL_STREAM_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POOL_DRAW_BINDING, pool->sbo);
+
+	BindVertexArray(pool->vao);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)pool->commands.size(), 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, GL_NONE);
+
+	pool->commands.clear();
+	pool->draws.clear();
+}
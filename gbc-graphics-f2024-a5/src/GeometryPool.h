@@ -0,0 +1,74 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "Math.h"
+#include "Mesh.h"
+#include "TextureAtlas.h"
+
+// Shader storage binding of the per-draw data shaders compiled with POOLED read. Must match default.vert
+constexpr GLuint POOL_DRAW_BINDING = 1;
+
+// Indices of one level of detail within the pool's element buffer
+struct PoolRange
+{
+	GLuint firstIndex = 0;
+	GLuint count = 0;
+};
+
+// Where a mesh added to a pool lives
+struct PoolMesh
+{
+	GLint baseVertex = 0;
+	std::vector<PoolRange> levels;	// Level 0 is the full mesh, i > 0 is mesh.lods[i - 1]
+};
+
+// What a pooled draw's shader fetches by gl_DrawID. Must match Draw in default.vert
+struct PoolDraw
+{
+	Matrix world;
+	Matrix normal;
+	Vector4 color;
+	Vector4 atlasRect;	// Read by programs compiled with ATLAS
+	int atlasLayer;
+	int padding[3];		// std430 rounds the struct up to its vec4 alignment
+};
+
+static_assert(sizeof(PoolDraw) == 176, "PoolDraw must match its std430 layout");
+
+// Every mesh's vertices & indices sub-allocated from one vertex & one element buffer behind one VAO,
+// so a pass over many different meshes is a single glMultiDrawElementsIndirect
+struct GeometryPool
+{
+	GLuint vao = GL_NONE;
+	GLuint vbo = GL_NONE;	// PackedVertex
+	GLuint ebo = GL_NONE;	// 32-bit indices, since every draw of a multi-draw shares the index type
+	GLuint dbo = GL_NONE;	// Draw commands of the current pass
+	GLuint sbo = GL_NONE;	// PoolDraw of each command
+
+	GLuint vertexCapacity = 0;
+	GLuint indexCapacity = 0;
+	GLuint vertexCount = 0;
+	GLuint indexCount = 0;
+
+	// Filled by SubmitPoolDraw, emptied by DrawGeometryPool
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<PoolDraw> draws;
+};
+
+// Allocates room for vertexCapacity vertices & indexCapacity indices. The pool doesn't grow
+void CreateGeometryPool(GeometryPool* pool, GLuint vertexCapacity, GLuint indexCapacity);
+void DestroyGeometryPool(GeometryPool* pool);
+
+// Copies the mesh's vertices & the indices of every level into the pool. Uses the mesh's CPU data, so it can be added
+// whatever its vertex format. Pooled meshes are never freed individually
+PoolMesh AddToPool(GeometryPool* pool, const Mesh& mesh);
+
+// Adds a draw of one of the mesh's levels to the pool's pass. Draws textured from an atlas pass their region, so
+// draws of different images are still one call
+void SubmitPoolDraw(GeometryPool* pool, const PoolMesh& mesh, int level, Matrix world, Matrix normal, Vector3 color,
+	const AtlasRegion& region = AtlasRegion{});
+
+// Uploads the pass's commands & per-draw data, then draws every one of them with a single call & empties the pass.
+// The bound program must be compiled with POOLED
+void DrawGeometryPool(GeometryPool* pool);
@@ -0,0 +1,64 @@
+#include "Light.h"
+#include <cassert>
+#include <cstring>
+
+GLuint CreateLightBuffer()
+{
+	GLuint ubo = GL_NONE;
+	glGenBuffers(1, &ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, GL_NONE);
+
+	// Programs declare the block with layout(binding = 0) so the buffer stays bound for all of them
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BINDING, ubo);
+	return ubo;
+}
+
+void DestroyLightBuffer(GLuint* ubo)
+{
+	glDeleteBuffers(1, ubo);
+	*ubo = GL_NONE;
+}
+
+void UpdateLightBuffer(GLuint ubo, Vector3 camPos, const Light* lights, int count)
+{
+	assert(count >= 0 && count <= MAX_LIGHTS);
+
+	// Only the lights in use are uploaded, shaders stop at count
+	LightBlock block;
+	block.camPos = camPos;
+	block.count = count;
+	memcpy(block.lights, lights, count * sizeof(Light));
+	glNamedBufferSubData(ubo, 0, offsetof(LightBlock, lights) + count * sizeof(Light), &block);
+}
+
+uint32_t PhongFeatures(bool textured, const Light* lights, int count)
+{
+	uint32_t features = PhongLights(count);
+	if (textured)
+		features |= PHONG_TEXTURED;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (lights[i].type == LIGHT_SPOT)
+			features |= PHONG_SPOT;
+		else if (lights[i].radius > 0.0f)
+			features |= PHONG_ATTENUATION;
+	}
+	return features;
+}
+
+std::string PhongDefines(uint32_t features)
+{
+	std::string defines;
+	if (features & PHONG_TEXTURED)
+		defines += "#define TEXTURED\n";
+	if (features & PHONG_SPOT)
+		defines += "#define SPOT\n";
+	if (features & PHONG_ATTENUATION)
+		defines += "#define ATTENUATION\n";
+	if (!(features & PHONG_LIGHT_LOOP))
+		defines += "#define NUM_LIGHTS " + std::to_string(features >> 8) + "\n";
+	return defines;
+}
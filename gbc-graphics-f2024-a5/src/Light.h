@@ -0,0 +1,72 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Math.h"
+
+// Uniform buffer binding point of the Lights block every Phong shader declares
+constexpr GLuint LIGHTS_BINDING = 0;
+
+// Must match MAX_LIGHTS in the shaders
+constexpr int MAX_LIGHTS = 256;
+
+enum LightType
+{
+	LIGHT_POINT,		// Phong lighting attenuated by radius / distance (unless radius is 0)
+	LIGHT_DIRECTION,	// Ambient & diffuse only, attenuated like point lights
+	LIGHT_SPOT			// Ambient only, within a cone of angle degrees around direction
+};
+
+// std140 layout of the shaders' Light struct (3 vec4s)
+struct Light
+{
+	Vector3 position = V3_ZERO;
+	float radius = 1.0f;
+	Vector3 color = V3_ONE;
+	int type = LIGHT_POINT;
+	Vector3 direction = V3_ZERO;
+	float angle = 0.0f;
+};
+
+// Features of phong.frag. Each is a #define, so variants without one skip its work
+enum PhongFeature : uint32_t
+{
+	PHONG_TEXTURED = 1 << 0,	// Albedo from u_tex rather than grey
+	PHONG_SPOT = 1 << 1,		// Spot lights are lit
+	PHONG_ATTENUATION = 1 << 2,	// Lights with a radius are dimmed by radius / distance
+	PHONG_LIGHT_LOOP = 1 << 3	// Loops over u_lightCount rather than a light count known at compile time
+};
+
+// Light counts up to this are compiled into the variant (NUM_LIGHTS) so its loop can be unrolled
+constexpr int PHONG_MAX_UNROLLED_LIGHTS = 8;
+
+// The light count part of a variant's features
+constexpr uint32_t PhongLights(int count)
+{
+	return count <= PHONG_MAX_UNROLLED_LIGHTS ? (uint32_t)count << 8 : PHONG_LIGHT_LOOP;
+}
+
+// Smallest set of features that lights count lights correctly. Pass the same lights as UpdateLightBuffer
+uint32_t PhongFeatures(bool textured, const Light* lights, int count);
+
+// #define lines of a phong.frag variant, for ProgramVariants
+std::string PhongDefines(uint32_t features);
+
+// std140 layout of the shaders' Lights block
+struct LightBlock
+{
+	Vector3 camPos;
+	int count;
+	Light lights[MAX_LIGHTS];
+};
+
+static_assert(sizeof(Light) == 48, "Light must match its std140 layout");
+static_assert(offsetof(LightBlock, lights) == 16, "LightBlock must match its std140 layout");
+
+// Allocates a uniform buffer for MAX_LIGHTS lights & binds it to LIGHTS_BINDING
+GLuint CreateLightBuffer();
+void DestroyLightBuffer(GLuint* ubo);
+
+// Uploads the camera position & the first count lights. Call once per frame before drawing
+void UpdateLightBuffer(GLuint ubo, Vector3 camPos, const Light* lights, int count);
@@ -1,6 +1,7 @@
 #pragma once
 #include <cmath>
 #include <cstdlib>
+#include "Simd.h"
 
 //----------------------------------------------------------------------------------
 // Defines and Macros
@@ -829,6 +830,7 @@ RMAPI Vector3 Divide(Vector3 v1, Vector3 v2)
 }
 
 // Normalize provided vector
+// NOTE: Left scalar. A Vector3 doesn't fill a SIMD register, so packing & unpacking it costs more than SIMD saves
 RMAPI Vector3 Normalize(Vector3 v)
 {
     Vector3 result = v;
@@ -1246,8 +1248,27 @@ RMAPI float Trace(Matrix mat)
     return result;
 }
 
-// Transposes provided matrix
-RMAPI Matrix Transpose(Matrix mat)
+// Load a matrix's physical rows (m0 m4 m8 m12, m1 m5 m9 m13, ...) into SIMD registers
+RMAPI void SimdLoad(Matrix mat, SimdVec rows[4])
+{
+    rows[0] = SimdLoad(&mat.m0);
+    rows[1] = SimdLoad(&mat.m1);
+    rows[2] = SimdLoad(&mat.m2);
+    rows[3] = SimdLoad(&mat.m3);
+}
+
+RMAPI Matrix SimdStore(const SimdVec rows[4])
+{
+    Matrix result;
+    SimdStore(&result.m0, rows[0]);
+    SimdStore(&result.m1, rows[1]);
+    SimdStore(&result.m2, rows[2]);
+    SimdStore(&result.m3, rows[3]);
+    return result;
+}
+
+// Transposes provided matrix (reference version of Transpose without SIMD)
+RMAPI Matrix TransposeScalar(Matrix mat)
 {
     Matrix result = { 0 };
 
@@ -1271,8 +1292,21 @@ RMAPI Matrix Transpose(Matrix mat)
     return result;
 }
 
-// Invert provided matrix
-RMAPI Matrix Invert(Matrix mat)
+// Transposes provided matrix
+RMAPI Matrix Transpose(Matrix mat)
+{
+#if defined(SIMD_SCALAR)
+    return TransposeScalar(mat);
+#else
+    SimdVec rows[4];
+    SimdLoad(mat, rows);
+    SimdTranspose(&rows[0], &rows[1], &rows[2], &rows[3]);
+    return SimdStore(rows);
+#endif
+}
+
+// Invert provided matrix (reference version of Invert without SIMD)
+RMAPI Matrix InvertScalar(Matrix mat)
 {
     Matrix result = { 0 };
 
@@ -1318,6 +1352,80 @@ RMAPI Matrix Invert(Matrix mat)
     return result;
 }
 
+// 2x2 matrix products for Invert's block inverse. Each SimdVec holds a 2x2 matrix as | x y |
+//                                                                                   | z w |
+// a * b
+RMAPI SimdVec SimdMat2Mul(SimdVec a, SimdVec b)
+{
+    return SimdAdd(SimdMul(a, SimdShuffle<0, 3, 0, 3>(b, b)), SimdMul(SimdShuffle<1, 0, 3, 2>(a, a), SimdShuffle<2, 1, 2, 1>(b, b)));
+}
+
+// adjugate(a) * b
+RMAPI SimdVec SimdMat2AdjMul(SimdVec a, SimdVec b)
+{
+    return SimdSub(SimdMul(SimdShuffle<3, 3, 0, 0>(a, a), b), SimdMul(SimdShuffle<1, 1, 2, 2>(a, a), SimdShuffle<2, 3, 0, 1>(b, b)));
+}
+
+// a * adjugate(b)
+RMAPI SimdVec SimdMat2MulAdj(SimdVec a, SimdVec b)
+{
+    return SimdSub(SimdMul(a, SimdShuffle<3, 0, 3, 0>(b, b)), SimdMul(SimdShuffle<1, 0, 3, 2>(a, a), SimdShuffle<2, 1, 2, 1>(b, b)));
+}
+
+// Invert provided matrix
+// NOTE: The SIMD version inverts by 2x2 blocks, so results can differ from InvertScalar in the last few bits
+RMAPI Matrix Invert(Matrix mat)
+{
+#if defined(SIMD_SCALAR)
+    return InvertScalar(mat);
+#else
+    SimdVec rows[4];
+    SimdLoad(mat, rows);
+
+    // Split into 2x2 blocks | A B |
+    //                       | C D |
+    SimdVec A = SimdShuffle<0, 1, 0, 1>(rows[0], rows[1]);
+    SimdVec B = SimdShuffle<2, 3, 2, 3>(rows[0], rows[1]);
+    SimdVec C = SimdShuffle<0, 1, 0, 1>(rows[2], rows[3]);
+    SimdVec D = SimdShuffle<2, 3, 2, 3>(rows[2], rows[3]);
+
+    // Block determinants as (|A| |B| |C| |D|)
+    SimdVec detSub = SimdSub(
+        SimdMul(SimdShuffle<0, 2, 0, 2>(rows[0], rows[2]), SimdShuffle<1, 3, 1, 3>(rows[1], rows[3])),
+        SimdMul(SimdShuffle<1, 3, 1, 3>(rows[0], rows[2]), SimdShuffle<0, 2, 0, 2>(rows[1], rows[3])));
+    SimdVec detA = SimdLane<0>(detSub);
+    SimdVec detB = SimdLane<1>(detSub);
+    SimdVec detC = SimdLane<2>(detSub);
+    SimdVec detD = SimdLane<3>(detSub);
+
+    // The inverse is 1/|M| * | X Y |, found through the blocks' adjugates (X_ = adjugate(X) etc.)
+    //                        | Z W |
+    SimdVec D_C = SimdMat2AdjMul(D, C);
+    SimdVec A_B = SimdMat2AdjMul(A, B);
+    SimdVec X_ = SimdSub(SimdMul(detD, A), SimdMat2Mul(B, D_C));
+    SimdVec W_ = SimdSub(SimdMul(detA, D), SimdMat2Mul(C, A_B));
+    SimdVec Y_ = SimdSub(SimdMul(detB, C), SimdMat2MulAdj(D, A_B));
+    SimdVec Z_ = SimdSub(SimdMul(detC, B), SimdMat2MulAdj(A, D_C));
+
+    // |M| = |A||D| + |B||C| - trace((A_B)(D_C))
+    SimdVec trace = SimdSum(SimdMul(A_B, SimdShuffle<0, 2, 1, 3>(D_C, D_C)));
+    SimdVec detM = SimdSub(SimdAdd(SimdMul(detA, detD), SimdMul(detB, detC)), trace);
+    SimdVec invDetM = SimdDiv(SimdSet(1.0f, -1.0f, -1.0f, 1.0f), detM);
+
+    X_ = SimdMul(X_, invDetM);
+    Y_ = SimdMul(Y_, invDetM);
+    Z_ = SimdMul(Z_, invDetM);
+    W_ = SimdMul(W_, invDetM);
+
+    // Undo the adjugates while reassembling the rows
+    rows[0] = SimdShuffle<3, 1, 3, 1>(X_, Y_);
+    rows[1] = SimdShuffle<2, 0, 2, 0>(X_, Y_);
+    rows[2] = SimdShuffle<3, 1, 3, 1>(Z_, W_);
+    rows[3] = SimdShuffle<2, 0, 2, 0>(Z_, W_);
+    return SimdStore(rows);
+#endif
+}
+
 // Get identity matrix
 RMAPI Matrix MatrixIdentity(void)
 {
@@ -1379,9 +1487,9 @@ RMAPI Matrix Subtract(Matrix left, Matrix right)
     return result;
 }
 
-// Get two matrix multiplication
+// Get two matrix multiplication (reference version of Multiply without SIMD)
 // NOTE: When multiplying matrices... the order matters!
-RMAPI Matrix Multiply(Matrix left, Matrix right)
+RMAPI Matrix MultiplyScalar(Matrix left, Matrix right)
 {
     Matrix result = { 0 };
 
@@ -1405,6 +1513,35 @@ RMAPI Matrix Multiply(Matrix left, Matrix right)
     return result;
 }
 
+// weights.x * rows[0] + weights.y * rows[1] + weights.z * rows[2] + weights.w * rows[3]
+RMAPI SimdVec SimdCombine(SimdVec weights, const SimdVec rows[4])
+{
+    SimdVec result = SimdMul(SimdLane<0>(weights), rows[0]);
+    result = SimdAdd(result, SimdMul(SimdLane<1>(weights), rows[1]));
+    result = SimdAdd(result, SimdMul(SimdLane<2>(weights), rows[2]));
+    return SimdAdd(result, SimdMul(SimdLane<3>(weights), rows[3]));
+}
+
+// Get two matrix multiplication
+// NOTE: When multiplying matrices... the order matters!
+RMAPI Matrix Multiply(Matrix left, Matrix right)
+{
+#if defined(SIMD_SCALAR)
+    return MultiplyScalar(left, right);
+#else
+    // Each physical row of the result is a combination of left's physical rows weighted by right's row.
+    // Products are summed in the same order as MultiplyScalar, so results are identical
+    SimdVec l[4], r[4];
+    SimdLoad(left, l);
+    SimdLoad(right, r);
+    r[0] = SimdCombine(r[0], l);
+    r[1] = SimdCombine(r[1], l);
+    r[2] = SimdCombine(r[2], l);
+    r[3] = SimdCombine(r[3], l);
+    return SimdStore(r);
+#endif
+}
+
 // Get translation matrix
 RMAPI Matrix Translate(float x, float y, float z)
 {
@@ -2227,8 +2364,8 @@ RMAPI Vector3 ToEuler(Quaternion q)
     return result;
 }
 
-// Transform a quaternion given a transformation matrix
-RMAPI Quaternion Multiply(Quaternion q, Matrix mat)
+// Transform a quaternion given a transformation matrix (reference version of Multiply without SIMD)
+RMAPI Quaternion MultiplyScalar(Quaternion q, Matrix mat)
 {
     Quaternion result = { 0 };
 
@@ -2240,6 +2377,28 @@ RMAPI Quaternion Multiply(Quaternion q, Matrix mat)
     return result;
 }
 
+// Transform a quaternion given a transformation matrix
+RMAPI Quaternion Multiply(Quaternion q, Matrix mat)
+{
+#if defined(SIMD_SCALAR)
+    return MultiplyScalar(q, mat);
+#else
+    // Transposing gives the matrix's logical columns (m0 m1 m2 m3, m4 m5 m6 m7, ...) to scale by each component
+    SimdVec columns[4];
+    SimdLoad(mat, columns);
+    SimdTranspose(&columns[0], &columns[1], &columns[2], &columns[3]);
+
+    SimdVec result = SimdMul(columns[0], SimdSplat(q.x));
+    result = SimdAdd(result, SimdMul(columns[1], SimdSplat(q.y)));
+    result = SimdAdd(result, SimdMul(columns[2], SimdSplat(q.z)));
+    result = SimdAdd(result, SimdMul(columns[3], SimdSplat(q.w)));
+
+    Quaternion transformed;
+    SimdStore(&transformed.x, result);
+    return transformed;
+#endif
+}
+
 // Check whether two given quaternions are almost equal
 RMAPI int Equals(Quaternion p, Quaternion q)
 {
@@ -2673,3 +2832,218 @@ RMAPI Vector4::operator Vector3() const
 {
     return { x, y, z };
 }
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition - Batched transforms
+//----------------------------------------------------------------------------------
+
+// Strided view of vectors whose components may live anywhere: element i's x is at (char*)x + i * stride.
+// Covers arrays of vectors (AoS), vectors inside larger vertex structs, or one array per component (SoA)
+template<typename T>
+struct Span3 {
+    T* x;
+    T* y;
+    T* z;
+    size_t stride;      // Bytes between consecutive elements
+
+    // Writable spans can be passed as inputs
+    operator Span3<const T>() const { return { x, y, z, stride }; }
+};
+
+typedef Span3<float> Vector3Span;
+typedef Span3<const float> ConstVector3Span;
+
+// Span over an array of Vector3 (or any struct with a Vector3 member, given its size as stride)
+RMAPI Vector3Span ToSpan(Vector3* v, size_t stride = sizeof(Vector3))
+{
+    return { &v->x, &v->y, &v->z, stride };
+}
+
+RMAPI ConstVector3Span ToSpan(const Vector3* v, size_t stride = sizeof(Vector3))
+{
+    return { &v->x, &v->y, &v->z, stride };
+}
+
+// Span over separate x, y & z arrays
+RMAPI Vector3Span ToSpan(float* x, float* y, float* z)
+{
+    return { x, y, z, sizeof(float) };
+}
+
+RMAPI ConstVector3Span ToSpan(const float* x, const float* y, const float* z)
+{
+    return { x, y, z, sizeof(float) };
+}
+
+RMAPI float& SpanAt(float* p, size_t stride, size_t i)
+{
+    return *(float*)((char*)p + i * stride);
+}
+
+RMAPI const float& SpanAt(const float* p, size_t stride, size_t i)
+{
+    return *(const float*)((const char*)p + i * stride);
+}
+
+// Interleaved spans are transformed in blocks copied to & from local x, y & z arrays, so the SIMD loops always read &
+// write contiguous floats. Spans already split into arrays are transformed in place
+#define BATCH_BLOCK_SIZE 256
+
+// x, y & z follow each other in memory, like a Vector3
+template<typename T>
+RMAPI bool IsPacked(Span3<T> span)
+{
+    return span.y == span.x + 1 && span.z == span.x + 2;
+}
+
+// Copies elements first to first + count - 1 of span into x, y & z. total is the span's length
+RMAPI void SpanGather(ConstVector3Span span, size_t first, size_t count, size_t total, float* x, float* y, float* z)
+{
+    size_t i = 0;
+    if (IsPacked(span) && span.stride == 3 * sizeof(float))
+    {
+        // Array of Vector3: 4 elements are 3 vectors x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 to deinterleave
+        for (; i + 4 <= count; i += 4)
+        {
+            const float* p = &SpanAt(span.x, span.stride, first + i);
+            SimdVec a = SimdLoad(p), b = SimdLoad(p + 4), c = SimdLoad(p + 8);
+            SimdStore(x + i, SimdShuffle<0, 3, 0, 2>(a, SimdShuffle<2, 2, 1, 1>(b, c)));
+            SimdStore(y + i, SimdShuffle<0, 2, 0, 2>(SimdShuffle<1, 1, 0, 0>(a, b), SimdShuffle<3, 3, 2, 2>(b, c)));
+            SimdStore(z + i, SimdShuffle<0, 2, 0, 2>(SimdShuffle<2, 2, 1, 1>(a, b), SimdShuffle<0, 0, 3, 3>(c, c)));
+        }
+    }
+    else if (IsPacked(span))
+    {
+        // Vector3 inside a larger vertex: load 4 floats per element & transpose. Stops before the last element,
+        // where the 4th float could be past the end of the array
+        for (; i + 4 <= count && first + i + 4 < total; i += 4)
+        {
+            SimdVec vx = SimdLoad(&SpanAt(span.x, span.stride, first + i));
+            SimdVec vy = SimdLoad(&SpanAt(span.x, span.stride, first + i + 1));
+            SimdVec vz = SimdLoad(&SpanAt(span.x, span.stride, first + i + 2));
+            SimdVec vw = SimdLoad(&SpanAt(span.x, span.stride, first + i + 3));
+            SimdTranspose(&vx, &vy, &vz, &vw);
+            SimdStore(x + i, vx);
+            SimdStore(y + i, vy);
+            SimdStore(z + i, vz);
+        }
+    }
+
+    for (; i < count; i++)
+    {
+        x[i] = SpanAt(span.x, span.stride, first + i);
+        y[i] = SpanAt(span.y, span.stride, first + i);
+        z[i] = SpanAt(span.z, span.stride, first + i);
+    }
+}
+
+RMAPI void SpanScatter(Vector3Span span, size_t first, size_t count, const float* x, const float* y, const float* z)
+{
+    size_t i = 0;
+    if (IsPacked(span) && span.stride == 3 * sizeof(float))
+    {
+        // Reverse of SpanGather's deinterleave
+        for (; i + 4 <= count; i += 4)
+        {
+            float* p = &SpanAt(span.x, span.stride, first + i);
+            SimdVec vx = SimdLoad(x + i), vy = SimdLoad(y + i), vz = SimdLoad(z + i);
+            SimdStore(p, SimdShuffle<0, 2, 0, 2>(SimdShuffle<0, 0, 0, 0>(vx, vy), SimdShuffle<0, 0, 1, 1>(vz, vx)));
+            SimdStore(p + 4, SimdShuffle<0, 2, 0, 2>(SimdShuffle<1, 1, 1, 1>(vy, vz), SimdShuffle<2, 2, 2, 2>(vx, vy)));
+            SimdStore(p + 8, SimdShuffle<0, 2, 0, 2>(SimdShuffle<2, 2, 3, 3>(vz, vx), SimdShuffle<3, 3, 3, 3>(vy, vz)));
+        }
+    }
+
+    for (; i < count; i++)
+    {
+        SpanAt(span.x, span.stride, first + i) = x[i];
+        SpanAt(span.y, span.stride, first + i) = y[i];
+        SpanAt(span.z, span.stride, first + i) = z[i];
+    }
+}
+
+// Runs kernel(x, y, z, outX, outY, outZ, count) over contiguous arrays, copying blocks of interleaved spans
+template<typename Kernel>
+RMAPI void TransformSpan(ConstVector3Span in, Vector3Span out, size_t count, Kernel kernel)
+{
+    if (in.stride == sizeof(float) && out.stride == sizeof(float))
+    {
+        kernel(in.x, in.y, in.z, out.x, out.y, out.z, count);
+        return;
+    }
+
+    float x[BATCH_BLOCK_SIZE], y[BATCH_BLOCK_SIZE], z[BATCH_BLOCK_SIZE];
+    for (size_t first = 0; first < count; first += BATCH_BLOCK_SIZE)
+    {
+        size_t n = count - first < BATCH_BLOCK_SIZE ? count - first : BATCH_BLOCK_SIZE;
+        SpanGather(in, first, n, count, x, y, z);
+        kernel(x, y, z, x, y, z, n);
+        SpanScatter(out, first, n, x, y, z);
+    }
+}
+
+// Matrix rows splatted across all lanes so 4 elements transform at once
+struct SimdMatrix {
+    SimdVec m0, m4, m8, m12;
+    SimdVec m1, m5, m9, m13;
+    SimdVec m2, m6, m10, m14;
+    SimdVec m3, m7, m11, m15;
+};
+
+RMAPI SimdMatrix SimdSplat(Matrix mat)
+{
+    return {
+        SimdSplat(mat.m0), SimdSplat(mat.m4), SimdSplat(mat.m8), SimdSplat(mat.m12),
+        SimdSplat(mat.m1), SimdSplat(mat.m5), SimdSplat(mat.m9), SimdSplat(mat.m13),
+        SimdSplat(mat.m2), SimdSplat(mat.m6), SimdSplat(mat.m10), SimdSplat(mat.m14),
+        SimdSplat(mat.m3), SimdSplat(mat.m7), SimdSplat(mat.m11), SimdSplat(mat.m15)
+    };
+}
+
+// a * x + b * y + c * z, added in the same order as the scalar transforms so results are identical
+RMAPI SimdVec SimdDot3(SimdVec a, SimdVec b, SimdVec c, SimdVec x, SimdVec y, SimdVec z)
+{
+    return SimdAdd(SimdAdd(SimdMul(a, x), SimdMul(b, y)), SimdMul(c, z));
+}
+
+// Transforms count points (w = 1) by mat, 4 at a time. Same results as Multiply(Vector3, Matrix).
+// in & out may be the same span
+RMAPI void TransformPoints(Matrix mat, ConstVector3Span in, Vector3Span out, size_t count)
+{
+    SimdMatrix m = SimdSplat(mat);
+    TransformSpan(in, out, count, [&](const float* x, const float* y, const float* z, float* ox, float* oy, float* oz, size_t n) {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            SimdVec vx = SimdLoad(x + i), vy = SimdLoad(y + i), vz = SimdLoad(z + i);
+            SimdStore(ox + i, SimdAdd(SimdDot3(m.m0, m.m4, m.m8, vx, vy, vz), m.m12));
+            SimdStore(oy + i, SimdAdd(SimdDot3(m.m1, m.m5, m.m9, vx, vy, vz), m.m13));
+            SimdStore(oz + i, SimdAdd(SimdDot3(m.m2, m.m6, m.m10, vx, vy, vz), m.m14));
+        }
+
+        for (; i < n; i++)
+        {
+            Vector3 v = Multiply(Vector3{ x[i], y[i], z[i] }, mat);
+            ox[i] = v.x;
+            oy[i] = v.y;
+            oz[i] = v.z;
+        }
+    });
+}
+
+// out[i] = left[i] * right, ie each world matrix times a shared view-projection. out may be left
+RMAPI void MultiplyMatrices(const Matrix* left, Matrix right, Matrix* out, size_t count)
+{
+    // Same as Multiply, loading right's rows once for every matrix
+    SimdVec r[4];
+    SimdLoad(right, r);
+    for (size_t i = 0; i < count; i++)
+    {
+        SimdVec l[4], result[4];
+        SimdLoad(left[i], l);
+        result[0] = SimdCombine(r[0], l);
+        result[1] = SimdCombine(r[1], l);
+        result[2] = SimdCombine(r[2], l);
+        result[3] = SimdCombine(r[3], l);
+        out[i] = SimdStore(result);
+    }
+}
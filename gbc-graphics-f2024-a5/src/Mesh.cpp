@@ -3,59 +3,591 @@
 #include <par_shapes.h>
 #include <fast_obj.h>
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "File.h"
+#include "GLState.h"
 #include <cassert>
 #include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <sys/stat.h>
+
+// Identifies a unique obj vertex by its position, normal & tcoord indices
+struct VertexKey
+{
+	fastObjUInt p, n, t;
+
+	bool operator==(const VertexKey& other) const
+	{
+		return p == other.p && n == other.n && t == other.t;
+	}
+};
+
+struct VertexKeyHash
+{
+	size_t operator()(const VertexKey& key) const
+	{
+		// Large primes spread neighbouring indices across the table
+		return (key.p * 73856093u) ^ (key.n * 19349663u) ^ (key.t * 83492791u);
+	}
+};
+
+// Largest on-screen error we accept when picking a level of detail
+constexpr float LOD_PIXEL_ERROR = 1.0f;
+
+// Line-aligned slice of an obj file that one thread parses
+struct ObjChunk
+{
+	const char* begin = nullptr;
+	const char* end = nullptr;
+
+	// Index of this chunk's first position/tcoord/normal in the merged arrays
+	uint32_t positionBase = 0;
+	uint32_t tcoordBase = 0;
+	uint32_t normalBase = 0;
+
+	std::vector<fastObjIndex> indices;
+};
+
+enum ObjRecord
+{
+	OBJ_OTHER,
+	OBJ_POSITION,
+	OBJ_TCOORD,
+	OBJ_NORMAL,
+	OBJ_FACE
+};
+
+ObjRecord ClassifyObjLine(const char* ptr, const char** data);
+void CountObjChunk(ObjChunk* chunk);
+void ParseObjChunk(ObjChunk* chunk, float* positions, float* tcoords, float* normals);
+const char* ParseObjFace(const char* ptr, uint32_t positionCount, uint32_t tcoordCount, uint32_t normalCount, std::vector<fastObjIndex>* indices);
+const char* NextObjLine(const char* ptr, const char* end);
+template<typename Task>
+void ParallelFor(int count, Task task);
+
+void BuildObjMesh(Mesh* mesh, const char* path,
+	const float* positions, uint32_t positionCount,
+	const float* normals, uint32_t normalCount,
+	const float* tcoords, uint32_t tcoordCount,
+	const fastObjIndex* indices, uint32_t count);
 
 void Upload(Mesh* mesh);
+void PrintLods(const Mesh& mesh, const char* name);
+std::vector<uint8_t> PackIndices(const std::vector<uint32_t>& indices, GLenum type);
 
 void GenCube(Mesh* mesh, float width, float height, float length);
 
 void CreateMesh(Mesh* mesh, const char* path)
 {
-	fastObjMesh* obj = fast_obj_read(path);
-	int count = obj->index_count;
-	mesh->positions.resize(count);
-	mesh->normals.resize(count);
-	std::vector<fastObjIndex> indices(obj->index_count);
-	memcpy(indices.data(), obj->indices, indices.size() * sizeof(fastObjIndex));
-	
-	assert(obj->position_count > 1);
-	for (int i = 0; i < count; i++)
+	auto start = std::chrono::high_resolution_clock::now();
+	bool cached = LoadMeshCache(mesh, path);
+	VertexCacheStats before, after;
+	if (!cached)
 	{
-		// Using the obj file's indices, populate the mesh->positions with the object's vertex positions
-		fastObjIndex idx = obj->indices[i];
-		Vector3 position = ((Vector3*)obj->positions)[idx.p];
-		mesh->positions[i] = position;
+		// Left empty & not uploaded
+		if (!LoadObj(mesh, path))
+			return;
+		if (mesh->optimize)
+			OptimizeMesh(mesh, &before, &after);
+		else
+			mesh->meshlets = BuildMeshlets(&mesh->indices, mesh->positions);
+		GenerateLods(mesh, mesh->lodCount);
+		SaveMeshCache(*mesh, path);
 	}
-	
-	assert(obj->normal_count > 1);
-	for (int i = 0; i < count; i++)
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	int count = mesh->count;
+	int vertexCount = (int)mesh->positions.size();
+	size_t vertexSize = VertexSize(*mesh);
+	size_t flatBytes = count * vertexSize;
+	size_t indexedBytes = vertexCount * vertexSize + count * IndexSize(IndexType(vertexCount));
+	printf("Mesh %s: %s in %.2f ms\n", path, cached ? "loaded from cache" : "parsed", ms);
+	printf("Mesh %s: %i corners -> %i unique vertices (%.1f KB -> %.1f KB, %.1f KB saved)\n", path, count, vertexCount,
+		(float)flatBytes / 1024.0f, (float)indexedBytes / 1024.0f, ((float)flatBytes - (float)indexedBytes) / 1024.0f);
+	if (mesh->format == VERTEX_PACKED)
 	{
-		// Using the obj file's indices, populate the mesh->normals with the object's vertex normals
-		fastObjIndex idx = obj->indices[i];
-		Vector3 normal = ((Vector3*)obj->normals)[idx.n];
-		mesh->normals[i] = normal;
+		QuantizationError error = MeasureQuantizationError(*mesh);
+		printf("Mesh %s: packed position error %f, normal error %f, tcoord error %f\n", path, error.position, error.normal, error.tcoord);
 	}
-	
-	if (obj->texcoord_count > 1)
+
+	// Cached meshes were optimized before they were saved, so we only know how they perform now
+	if (!cached && mesh->optimize)
 	{
-		mesh->tcoords.resize(count);
-		for (int i = 0; i < count; i++)
-		{
-			// Using the obj file's indices, populate the mesh->tcoords with the object's vertex texture coordinates
-			fastObjIndex idx = obj->indices[i];
-			Vector2 tcoord = ((Vector2*)obj->texcoords)[idx.t];
-			mesh->tcoords[i] = tcoord;
-		}
+		printf("Mesh %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", path, before.acmr, after.acmr, before.atvr, after.atvr);
 	}
 	else
 	{
-		printf("**Warning: mesh %s loaded without texture coordinates**\n", path);
+		VertexCacheStats stats = AnalyzeVertexCache(mesh->indices, mesh->positions.size());
+		printf("Mesh %s: ACMR %.3f, ATVR %.3f\n", path, stats.acmr, stats.atvr);
+	}
+	PrintLods(*mesh, path);
+	printf("Mesh %s: %zu meshlets\n", path, mesh->meshlets.size());
+
+	Upload(mesh);
+}
+
+bool LoadObj(Mesh* mesh, const char* path, int threads)
+{
+	std::vector<uint8_t> file;
+	if (!ReadFile(path, &file))
+	{
+		printf("**Error: could not read mesh %s**\n", path);
+		return false;
+	}
+
+	// Like fast_obj, make sure the last line ends in a newline
+	if (file.empty() || file.back() != '\n')
+		file.push_back('\n');
+	const char* text = (const char*)file.data();
+	size_t size = file.size();
+
+	// Split the file into line-aligned chunks of at least 64KB so small files don't pay for threads they don't need
+	if (threads <= 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	int chunkCount = (int)std::min<size_t>(threads, std::max<size_t>(1, size / 65536));
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char* begin = text;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		const char* end = i == chunkCount - 1 ? text + size : text + size * (i + 1) / chunkCount;
+		while (end > begin && end[-1] != '\n')
+			end++;
+		chunks[i].begin = begin;
+		chunks[i].end = std::max(begin, end);
+		begin = chunks[i].end;
 	}
+
+	// 1. Count each chunk's records so every chunk knows where its vertices go in the merged arrays
+	ParallelFor(chunkCount, [&](int i) { CountObjChunk(&chunks[i]); });
+
+	// Index 0 of each array is a dummy element, matching fast_obj
+	uint32_t positionCount = 1, tcoordCount = 1, normalCount = 1;
+	for (ObjChunk& chunk : chunks)
+	{
+		uint32_t positions = chunk.positionBase, tcoords = chunk.tcoordBase, normals = chunk.normalBase;
+		chunk.positionBase = positionCount;
+		chunk.tcoordBase = tcoordCount;
+		chunk.normalBase = normalCount;
+		positionCount += positions;
+		tcoordCount += tcoords;
+		normalCount += normals;
+	}
+
+	std::vector<float> positions(positionCount * 3, 0.0f);
+	std::vector<float> tcoords(tcoordCount * 2, 0.0f);
+	std::vector<float> normals(normalCount * 3, 0.0f);
+	normals[2] = 1.0f;
+
+	// 2. Parse each chunk's vertices straight into the merged arrays & collect its face corners
+	ParallelFor(chunkCount, [&](int i) { ParseObjChunk(&chunks[i], positions.data(), tcoords.data(), normals.data()); });
+
+	std::vector<fastObjIndex> indices;
+	for (const ObjChunk& chunk : chunks)
+		indices.insert(indices.end(), chunk.indices.begin(), chunk.indices.end());
+
+	BuildObjMesh(mesh, path, positions.data(), positionCount, normals.data(), normalCount, tcoords.data(), tcoordCount, indices.data(), (uint32_t)indices.size());
+	return true;
+}
+
+bool LoadObjSerial(Mesh* mesh, const char* path)
+{
+	fastObjMesh* obj = fast_obj_read(path);
+	if (obj == nullptr)
+	{
+		printf("**Error: could not read mesh %s**\n", path);
+		return false;
+	}
+	BuildObjMesh(mesh, path, obj->positions, obj->position_count, obj->normals, obj->normal_count,
+		obj->texcoords, obj->texcoord_count, obj->indices, obj->index_count);
 	fast_obj_destroy(obj);
+	return true;
+}
+
+void BuildObjMesh(Mesh* mesh, const char* path,
+	const float* positions, uint32_t positionCount,
+	const float* normals, uint32_t normalCount,
+	const float* tcoords, uint32_t tcoordCount,
+	const fastObjIndex* indices, uint32_t count)
+{
+	assert(positionCount > 1);
+	assert(normalCount > 1);
+
+	bool hasTcoords = tcoordCount > 1;
+	if (!hasTcoords)
+		printf("**Warning: mesh %s loaded without texture coordinates**\n", path);
+
+	// Every face corner references a (position, normal, tcoord) triple.
+	// Corners that reference the same triple become a single vertex, so we store each unique vertex once and index it.
+	mesh->positions.clear();
+	mesh->normals.clear();
+	mesh->tcoords.clear();
+	mesh->indices.resize(count);
+	std::unordered_map<VertexKey, uint32_t, VertexKeyHash> lookup;
+	lookup.reserve(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		fastObjIndex idx = indices[i];
+		VertexKey key{ idx.p, idx.n, hasTcoords ? idx.t : 0 };
+		auto it = lookup.find(key);
+		if (it != lookup.end())
+		{
+			mesh->indices[i] = it->second;
+			continue;
+		}
+
+		uint32_t vertex = (uint32_t)mesh->positions.size();
+		lookup.insert({ key, vertex });
+		mesh->indices[i] = vertex;
+
+		mesh->positions.push_back(((const Vector3*)positions)[idx.p]);
+		mesh->normals.push_back(((const Vector3*)normals)[idx.n]);
+		if (hasTcoords)
+			mesh->tcoords.push_back(((const Vector2*)tcoords)[idx.t]);
+	}
+
+	// Freshly parsed, so none of CreateMesh's later steps have run on it
+	mesh->lods.clear();
+	mesh->meshlets.clear();
+	mesh->optimized = mesh->lodsGenerated = false;
 	mesh->count = count;
+	ComputeBounds(mesh);
+}
 
-	Upload(mesh);
+// Classifies the line at ptr the same way fast_obj's parse_buffer does.
+// Returns the record type and points data at the first character after its tag.
+ObjRecord ClassifyObjLine(const char* ptr, const char** data)
+{
+	ptr = skip_whitespace(ptr);
+	if (ptr[0] == 'v')
+	{
+		*data = ptr + 2;
+		if (ptr[1] == ' ' || ptr[1] == '\t')
+			return OBJ_POSITION;
+		if (ptr[1] == 't')
+			return OBJ_TCOORD;
+		if (ptr[1] == 'n')
+			return OBJ_NORMAL;
+	}
+	else if (ptr[0] == 'f' && (ptr[1] == ' ' || ptr[1] == '\t'))
+	{
+		*data = ptr + 2;
+		return OBJ_FACE;
+	}
+
+	*data = ptr;
+	return OBJ_OTHER;
+}
+
+void CountObjChunk(ObjChunk* chunk)
+{
+	uint32_t positions = 0, tcoords = 0, normals = 0;
+	const char* ptr = chunk->begin;
+	while (ptr < chunk->end)
+	{
+		const char* data;
+		switch (ClassifyObjLine(ptr, &data))
+		{
+		case OBJ_POSITION:
+			positions++;
+			break;
+		case OBJ_TCOORD:
+			tcoords++;
+			break;
+		case OBJ_NORMAL:
+			normals++;
+			break;
+		default:
+			break;
+		}
+		ptr = NextObjLine(data, chunk->end);
+	}
+
+	// Counts are stored in the base fields until LoadObj turns them into offsets
+	chunk->positionBase = positions;
+	chunk->tcoordBase = tcoords;
+	chunk->normalBase = normals;
+}
+
+void ParseObjChunk(ObjChunk* chunk, float* positions, float* tcoords, float* normals)
+{
+	// Counts include every element before this line (dummy included), which is what relative face indices count back from
+	uint32_t positionCount = chunk->positionBase;
+	uint32_t tcoordCount = chunk->tcoordBase;
+	uint32_t normalCount = chunk->normalBase;
+
+	const char* ptr = chunk->begin;
+	while (ptr < chunk->end)
+	{
+		const char* data;
+		switch (ClassifyObjLine(ptr, &data))
+		{
+		case OBJ_POSITION:
+			for (int i = 0; i < 3; i++)
+				data = parse_float(data, &positions[positionCount * 3 + i]);
+			positionCount++;
+			break;
+
+		case OBJ_TCOORD:
+			for (int i = 0; i < 2; i++)
+				data = parse_float(data, &tcoords[tcoordCount * 2 + i]);
+			tcoordCount++;
+			break;
+
+		case OBJ_NORMAL:
+			for (int i = 0; i < 3; i++)
+				data = parse_float(data, &normals[normalCount * 3 + i]);
+			normalCount++;
+			break;
+
+		case OBJ_FACE:
+			data = ParseObjFace(data, positionCount, tcoordCount, normalCount, &chunk->indices);
+			break;
+
+		default:
+			break;
+		}
+		ptr = NextObjLine(data, chunk->end);
+	}
+}
+
+// Start of the line after ptr. memchr is much faster than fast_obj's skip_line on long lines
+const char* NextObjLine(const char* ptr, const char* end)
+{
+	const char* newline = (const char*)memchr(ptr, '\n', end - ptr);
+	return newline != nullptr ? newline + 1 : end;
+}
+
+// Same rules as fast_obj's parse_face, but relative indices count back from the given totals
+const char* ParseObjFace(const char* ptr, uint32_t positionCount, uint32_t tcoordCount, uint32_t normalCount, std::vector<fastObjIndex>* indices)
+{
+	ptr = skip_whitespace(ptr);
+	while (!is_newline(*ptr))
+	{
+		int v = 0;
+		int t = 0;
+		int n = 0;
+
+		ptr = parse_int(ptr, &v);
+		if (*ptr == '/')
+		{
+			ptr++;
+			if (*ptr != '/')
+				ptr = parse_int(ptr, &t);
+
+			if (*ptr == '/')
+			{
+				ptr++;
+				ptr = parse_int(ptr, &n);
+			}
+		}
+
+		fastObjIndex index;
+		if (v < 0)
+			index.p = positionCount - (fastObjUInt)(-v);
+		else if (v > 0)
+			index.p = (fastObjUInt)v;
+		else
+			return ptr;	// Skip the rest of faces with no valid vertex index
+
+		if (t < 0)
+			index.t = tcoordCount - (fastObjUInt)(-t);
+		else
+			index.t = (fastObjUInt)t;
+
+		if (n < 0)
+			index.n = normalCount - (fastObjUInt)(-n);
+		else
+			index.n = (fastObjUInt)n;
+
+		indices->push_back(index);
+		ptr = skip_whitespace(ptr);
+	}
+
+	return ptr;
+}
+
+// Runs task(0) to task(count - 1), one thread each
+template<typename Task>
+void ParallelFor(int count, Task task)
+{
+	if (count == 1)
+	{
+		task(0);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	threads.reserve(count);
+	for (int i = 0; i < count; i++)
+		threads.emplace_back(task, i);
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+// Binary cache layout: MeshCacheHeader, positions, normals, tcoords (if any), 32-bit indices,
+// then each LOD's index count, error & 32-bit indices, then meshlets
+struct MeshCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;	// FNV-1a hash of the obj file the cache was built from
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t hasTcoords;
+	uint32_t optimized;	// Whether OptimizeMesh ran before the cache was saved
+	uint32_t lodCount;	// Mesh::lodCount the levels were generated with
+	uint32_t lodsGenerated;	// Levels actually stored after the indices (simplification may stop early)
+	uint32_t meshletCount;
+	Vector3 boundsMin;
+	Vector3 boundsMax;
+};
+
+constexpr uint32_t MESH_CACHE_MAGIC = 0x4853454D;	// "MESH"
+constexpr uint32_t MESH_CACHE_VERSION = 6;
+
+std::string MeshCachePath(const char* path)
+{
+	return std::string(path) + ".cache";
+}
+
+bool LoadMeshCache(Mesh* mesh, const char* path)
+{
+	std::string cachePath = MeshCachePath(path);
+	struct stat objStat, cacheStat;
+	if (stat(cachePath.c_str(), &cacheStat) != 0)
+		return false;
+
+	std::vector<uint8_t> bytes;
+	if (!ReadFile(cachePath.c_str(), &bytes) || bytes.size() < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader header{};
+	memcpy(&header, bytes.data(), sizeof(header));
+	if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION || header.optimized != (uint32_t)mesh->optimize ||
+		header.lodCount != (uint32_t)mesh->lodCount)
+		return false;
+
+	size_t vertexCount = header.vertexCount;
+	size_t tcoordCount = header.hasTcoords ? vertexCount : 0;
+	size_t size = sizeof(header) + vertexCount * sizeof(Vector3) * 2 + tcoordCount * sizeof(Vector2) + header.indexCount * sizeof(uint32_t);
+	if (bytes.size() < size)
+		return false;
+
+	// Only re-hash the obj if it was modified after the cache was written (ie the obj may have been edited)
+	bool stale = stat(path, &objStat) == 0 && objStat.st_mtime > cacheStat.st_mtime;
+	if (stale && HashFile(path) != header.sourceHash)
+		return false;
+
+	const uint8_t* data = bytes.data() + sizeof(header);
+	mesh->positions.assign((const Vector3*)data, (const Vector3*)data + vertexCount);
+	data += vertexCount * sizeof(Vector3);
+	mesh->normals.assign((const Vector3*)data, (const Vector3*)data + vertexCount);
+	data += vertexCount * sizeof(Vector3);
+	mesh->tcoords.assign((const Vector2*)data, (const Vector2*)data + tcoordCount);
+	data += tcoordCount * sizeof(Vector2);
+	mesh->indices.assign((const uint32_t*)data, (const uint32_t*)data + header.indexCount);
+	data += header.indexCount * sizeof(uint32_t);
+
+	const uint8_t* end = bytes.data() + bytes.size();
+	mesh->lods.resize(header.lodsGenerated);
+	for (MeshLod& lod : mesh->lods)
+	{
+		uint32_t count = 0;
+		if (end - data < (ptrdiff_t)(sizeof(count) + sizeof(lod.rmsError)))
+			return false;
+		memcpy(&count, data, sizeof(count));
+		memcpy(&lod.rmsError, data + sizeof(count), sizeof(lod.rmsError));
+		data += sizeof(count) + sizeof(lod.rmsError);
+
+		if ((size_t)(end - data) < count * sizeof(uint32_t))
+			return false;
+		lod.indices.assign((const uint32_t*)data, (const uint32_t*)data + count);
+		data += count * sizeof(uint32_t);
+	}
+
+	if ((size_t)(end - data) != header.meshletCount * sizeof(Meshlet))
+		return false;
+	mesh->meshlets.assign((const Meshlet*)data, (const Meshlet*)data + header.meshletCount);
+
+	mesh->count = header.indexCount;
+	mesh->boundsMin = header.boundsMin;
+	mesh->boundsMax = header.boundsMax;
+	mesh->optimized = header.optimized != 0;
+	mesh->lodsGenerated = true;
+
+	// Obj was touched but not changed, so rewrite the cache to skip hashing next time
+	if (stale)
+		SaveMeshCache(*mesh, path);
+	return true;
+}
+
+void SaveMeshCache(const Mesh& mesh, const char* path)
+{
+	// A cache stands in for every CPU step of CreateMesh on later launches, so one missing a step would skip it for good
+	if (mesh.optimized != mesh.optimize || !mesh.lodsGenerated || (mesh.meshlets.empty() && !mesh.indices.empty()))
+	{
+		printf("**Warning: mesh %s hasn't been through every step of CreateMesh, not caching it**\n", path);
+		return;
+	}
+
+	MeshCacheHeader header{};
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.sourceHash = HashFile(path);
+	header.vertexCount = (uint32_t)mesh.positions.size();
+	header.indexCount = (uint32_t)mesh.indices.size();
+	header.hasTcoords = !mesh.tcoords.empty();
+	header.optimized = mesh.optimized;
+	header.lodCount = mesh.lodCount;
+	header.lodsGenerated = (uint32_t)mesh.lods.size();
+	header.meshletCount = (uint32_t)mesh.meshlets.size();
+	header.boundsMin = mesh.boundsMin;
+	header.boundsMax = mesh.boundsMax;
+
+	std::string cachePath = MeshCachePath(path);
+	FILE* file = fopen(cachePath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		printf("**Warning: could not write mesh cache %s**\n", cachePath.c_str());
+		return;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(mesh.positions.data(), sizeof(Vector3), mesh.positions.size(), file);
+	fwrite(mesh.normals.data(), sizeof(Vector3), mesh.normals.size(), file);
+	fwrite(mesh.tcoords.data(), sizeof(Vector2), mesh.tcoords.size(), file);
+	fwrite(mesh.indices.data(), sizeof(uint32_t), mesh.indices.size(), file);
+	for (const MeshLod& lod : mesh.lods)
+	{
+		uint32_t count = (uint32_t)lod.indices.size();
+		fwrite(&count, sizeof(count), 1, file);
+		fwrite(&lod.rmsError, sizeof(lod.rmsError), 1, file);
+		fwrite(lod.indices.data(), sizeof(uint32_t), count, file);
+	}
+	fwrite(mesh.meshlets.data(), sizeof(Meshlet), mesh.meshlets.size(), file);
+	fclose(file);
+}
+
+void ComputeBounds(Mesh* mesh)
+{
+	if (mesh->positions.empty())
+	{
+		mesh->boundsMin = mesh->boundsMax = V3_ZERO;
+		return;
+	}
+
+	mesh->boundsMin = mesh->boundsMax = mesh->positions[0];
+	for (const Vector3& position : mesh->positions)
+	{
+		mesh->boundsMin = Min(mesh->boundsMin, position);
+		mesh->boundsMax = Max(mesh->boundsMax, position);
+	}
 }
 
 void CreateMesh(Mesh* mesh, ShapeType shape)
@@ -89,8 +621,7 @@ void CreateMesh(Mesh* mesh, ShapeType shape)
 		// 2. Convert par_shapes_mesh to our Mesh representation
 		int count = par->ntriangles * 3;	// 3 points per triangle
 		mesh->count = count;
-		mesh->indices.resize(count);
-		memcpy(mesh->indices.data(), par->triangles, count * sizeof(uint16_t));
+		mesh->indices.assign(par->triangles, par->triangles + count);
 		mesh->positions.resize(par->npoints);
 		memcpy(mesh->positions.data(), par->points, par->npoints * sizeof(Vector3));
 		mesh->normals.resize(par->npoints);
@@ -105,67 +636,304 @@ void CreateMesh(Mesh* mesh, ShapeType shape)
 		GenCube(mesh, 1.0f, 1.0f, 1.0f);
 	}
 
+	const char* names[] = { "PLANE", "CUBE", "SPHERE" };
+	if (mesh->optimize)
+	{
+		VertexCacheStats before, after;
+		OptimizeMesh(mesh, &before, &after);
+		printf("Mesh %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", names[shape], before.acmr, after.acmr, before.atvr, after.atvr);
+	}
+	else
+	{
+		mesh->meshlets = BuildMeshlets(&mesh->indices, mesh->positions);
+	}
+	GenerateLods(mesh, mesh->lodCount);
+	PrintLods(*mesh, names[shape]);
+
 	// 3. Upload Mesh to GPU
+	ComputeBounds(mesh);
 	Upload(mesh);
 }
 
 void DestroyMesh(Mesh* mesh)
 {
+	glDeleteBuffers(1, &mesh->dbo);
 	glDeleteBuffers(1, &mesh->ebo);
+	glDeleteBuffers(1, &mesh->vbo);
 	glDeleteBuffers(1, &mesh->tbo);
 	glDeleteBuffers(1, &mesh->nbo);
 	glDeleteBuffers(1, &mesh->pbo);
+	ForgetVertexArray(mesh->vao);
 	glDeleteVertexArrays(1, &mesh->vao);
 
-	mesh->vao = mesh->pbo = mesh->nbo = mesh->tbo = mesh->ebo = GL_NONE;
+	mesh->vao = mesh->pbo = mesh->nbo = mesh->tbo = mesh->vbo = mesh->ebo = mesh->dbo = GL_NONE;
 }
 
 void DrawMesh(const Mesh& mesh)
 {
-	glBindVertexArray(mesh.vao);
+	// Left bound so consecutive draws of the same mesh don't rebind it
+	BindVertexArray(mesh.vao);
 	if (mesh.ebo != GL_NONE)
-		glDrawElements(GL_TRIANGLES, mesh.count, GL_UNSIGNED_SHORT, nullptr);
+		glDrawElements(GL_TRIANGLES, mesh.count, mesh.indexType, nullptr);
 	else
 		glDrawArrays(GL_TRIANGLES, 0, mesh.count);
-	glBindVertexArray(GL_NONE);
+}
+
+void DrawMesh(const Mesh& mesh, Matrix world, Matrix view, Matrix proj, float viewportHeight)
+{
+	int level = SelectLod(mesh, world, view, proj, viewportHeight);
+	if (mesh.ebo == GL_NONE || (level == 0 && mesh.dbo == GL_NONE))
+	{
+		DrawMesh(mesh);
+		return;
+	}
+
+	BindVertexArray(mesh.vao);
+	if (level > 0)
+	{
+		const MeshLod& lod = mesh.lods[level - 1];
+		glDrawElements(GL_TRIANGLES, (GLsizei)lod.indices.size(), mesh.indexType, (void*)lod.offset);
+	}
+	else
+	{
+		// Reused between draws to avoid reallocating every frame
+		static std::vector<DrawElementsIndirectCommand> commands;
+		commands.clear();
+		CullMeshlets(mesh, world, view, proj, &commands);
+		if (!commands.empty())
+		{
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mesh.dbo);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+			glMultiDrawElementsIndirect(GL_TRIANGLES, mesh.indexType, nullptr, (GLsizei)commands.size(), 0);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, GL_NONE);
+		}
+	}
+}
+
+// Streams the instances of every DrawMeshInstanced call. Reallocated each draw so the driver never waits on the last
+static GLuint gInstanceBuffer = GL_NONE;
+
+void DrawMeshInstanced(const Mesh& mesh, const Matrix* worlds, const Vector3* colors, int count, int level)
+{
+	if (count <= 0)
+		return;
+
+	if (gInstanceBuffer == GL_NONE)
+		glGenBuffers(1, &gInstanceBuffer);
+
+	// Matrices are uploaded as they are. Shaders account for them being stored row by row
+	size_t worldBytes = count * sizeof(Matrix);
+	size_t colorBytes = colors != nullptr ? count * sizeof(Vector3) : 0;
+	glBindBuffer(GL_ARRAY_BUFFER, gInstanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, worldBytes + colorBytes, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, worldBytes, worlds);
+	if (colors != nullptr)
+		glBufferSubData(GL_ARRAY_BUFFER, worldBytes, colorBytes, colors);
+
+	BindVertexArray(mesh.vao);
+	for (GLuint i = 0; i < 4; i++)
+	{
+		GLuint location = INSTANCE_WORLD_LOCATION + i;
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Matrix), (void*)(i * sizeof(Vector4)));
+		glVertexAttribDivisor(location, 1);
+		glEnableVertexAttribArray(location);
+	}
+
+	if (colors != nullptr)
+	{
+		glVertexAttribPointer(INSTANCE_COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vector3), (void*)worldBytes);
+		glVertexAttribDivisor(INSTANCE_COLOR_LOCATION, 1);
+		glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+	}
+	else
+	{
+		// Disabled attributes read this constant instead
+		glDisableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+		glVertexAttrib3f(INSTANCE_COLOR_LOCATION, 1.0f, 1.0f, 1.0f);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
+
+	if (mesh.ebo == GL_NONE)
+		glDrawArraysInstanced(GL_TRIANGLES, 0, mesh.count, count);
+	else if (level > 0)
+		glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)mesh.lods[level - 1].indices.size(), mesh.indexType, (void*)mesh.lods[level - 1].offset, count);
+	else
+		glDrawElementsInstanced(GL_TRIANGLES, mesh.count, mesh.indexType, nullptr, count);
+
+	// The mesh's other draws don't have instances
+	for (GLuint location = INSTANCE_WORLD_LOCATION; location <= INSTANCE_COLOR_LOCATION; location++)
+		glDisableVertexAttribArray(location);
+}
+
+MeshletCullStats CullMeshlets(const Mesh& mesh, Matrix world, Matrix view, Matrix proj, std::vector<DrawElementsIndirectCommand>* commands)
+{
+	// Frustum planes in object space (Gribb & Hartmann), so meshlet bounds don't need transforming
+	Matrix m = world * view * proj;
+	Vector4 planes[6] =
+	{
+		{ m.m3 + m.m0, m.m7 + m.m4, m.m11 + m.m8, m.m15 + m.m12 },	// Left
+		{ m.m3 - m.m0, m.m7 - m.m4, m.m11 - m.m8, m.m15 - m.m12 },	// Right
+		{ m.m3 + m.m1, m.m7 + m.m5, m.m11 + m.m9, m.m15 + m.m13 },	// Bottom
+		{ m.m3 - m.m1, m.m7 - m.m5, m.m11 - m.m9, m.m15 - m.m13 },	// Top
+		{ m.m3 + m.m2, m.m7 + m.m6, m.m11 + m.m10, m.m15 + m.m14 },	// Near
+		{ m.m3 - m.m2, m.m7 - m.m6, m.m11 - m.m10, m.m15 - m.m14 }	// Far
+	};
+	for (Vector4& plane : planes)
+		plane = plane / Length(Vector3{ plane.x, plane.y, plane.z });
+
+	// Camera position in object space
+	Vector3 camera = Multiply(V3_ZERO, Invert(world * view));
+
+	MeshletCullStats stats;
+	for (const Meshlet& meshlet : mesh.meshlets)
+	{
+		bool outside = false;
+		for (const Vector4& plane : planes)
+			outside = outside || plane.x * meshlet.center.x + plane.y * meshlet.center.y + plane.z * meshlet.center.z + plane.w < -meshlet.radius;
+		if (outside)
+		{
+			stats.frustumCulled++;
+			continue;
+		}
+
+		Vector3 toApex = meshlet.coneApex - camera;
+		if (Dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * Length(toApex))
+		{
+			stats.backfaceCulled++;
+			continue;
+		}
+
+		// Meshlets are contiguous in the index buffer, so neighbouring visible meshlets share one command
+		if (!commands->empty() && commands->back().firstIndex + commands->back().count == meshlet.offset)
+			commands->back().count += meshlet.count;
+		else
+			commands->push_back({ meshlet.count, 1, meshlet.offset, 0, 0 });
+
+		stats.visible++;
+		stats.triangles += meshlet.count / 3;
+	}
+	return stats;
+}
+
+int SelectLod(const Mesh& mesh, Matrix world, Matrix view, Matrix proj, float viewportHeight)
+{
+	// The world matrix's largest axis scale
+	float scaleX = Length(Vector3{ world.m0, world.m1, world.m2 });
+	float scaleY = Length(Vector3{ world.m4, world.m5, world.m6 });
+	float scaleZ = Length(Vector3{ world.m8, world.m9, world.m10 });
+	float scale = std::max(std::max(scaleX, scaleY), scaleZ);
+
+	Vector3 center = Multiply((mesh.boundsMin + mesh.boundsMax) * 0.5f, world * view);
+	return SelectLod(mesh, scale, -center.z, proj, viewportHeight);
+}
+
+int SelectLod(const Mesh& mesh, float scale, float depth, Matrix proj, float viewportHeight)
+{
+	if (mesh.lods.empty())
+		return 0;
+
+	// Largest dimension of the mesh in world space
+	Vector3 size = mesh.boundsMax - mesh.boundsMin;
+	float extent = std::max(std::max(size.x, size.y), size.z) * scale;
+
+	// Perspective projections shrink the mesh with view depth, orthographic ones don't (m11 is 0)
+	depth = proj.m11 != 0.0f ? std::max(depth, extent * 0.5f) : 1.0f;
+	float pixels = extent * proj.m5 / depth * viewportHeight * 0.5f;
+
+	int level = 0;
+	while (level < (int)mesh.lods.size() && mesh.lods[level].rmsError * pixels <= LOD_PIXEL_ERROR)
+		level++;
+	return level;
 }
 
 void Upload(Mesh* mesh)
 {
-	GLuint vao, pbo, nbo, tbo, ebo;
-	vao = pbo = nbo = tbo = ebo = GL_NONE;
+	GLuint vao, pbo, nbo, tbo, vbo, ebo, dbo;
+	vao = pbo = nbo = tbo = vbo = ebo = dbo = GL_NONE;
 	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	BindVertexArray(vao);
 	
-	glGenBuffers(1, &pbo);
-	glBindBuffer(GL_ARRAY_BUFFER, pbo);
-	glBufferData(GL_ARRAY_BUFFER, mesh->positions.size() * sizeof(Vector3), mesh->positions.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vector3), nullptr);
-	glEnableVertexAttribArray(0);
-
-	glGenBuffers(1, &nbo);
-	glBindBuffer(GL_ARRAY_BUFFER, nbo);
-	glBufferData(GL_ARRAY_BUFFER, mesh->normals.size() * sizeof(Vector3), mesh->normals.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vector3), nullptr);
-	glEnableVertexAttribArray(1);
-
-	if (!mesh->tcoords.empty())
-	{
-		glGenBuffers(1, &tbo);
-		glBindBuffer(GL_ARRAY_BUFFER, tbo);
-		glBufferData(GL_ARRAY_BUFFER, mesh->tcoords.size() * sizeof(Vector2), mesh->tcoords.data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vector2), nullptr);
-		glEnableVertexAttribArray(2);
+	if (mesh->format == VERTEX_PACKED)
+	{
+		std::vector<PackedVertex> vertices = PackVertices(*mesh);
+#ifndef NDEBUG
+		QuantizationError error = MeasureQuantizationError(*mesh);
+		assert(error.position <= POSITION_TOLERANCE);
+		assert(error.normal <= NORMAL_TOLERANCE);
+		assert(error.tcoord <= TCOORD_TOLERANCE);
+#endif
+
+		glGenBuffers(1, &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), vertices.data(), GL_STATIC_DRAW);
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+		glEnableVertexAttribArray(0);
+
+		// Packed normals must be fetched as 4 components. The shader only reads xyz
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+		glEnableVertexAttribArray(1);
+
+		if (!mesh->tcoords.empty())
+		{
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tcoord));
+			glEnableVertexAttribArray(2);
+		}
+	}
+	else
+	{
+		glGenBuffers(1, &pbo);
+		glBindBuffer(GL_ARRAY_BUFFER, pbo);
+		glBufferData(GL_ARRAY_BUFFER, mesh->positions.size() * sizeof(Vector3), mesh->positions.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vector3), nullptr);
+		glEnableVertexAttribArray(0);
+
+		glGenBuffers(1, &nbo);
+		glBindBuffer(GL_ARRAY_BUFFER, nbo);
+		glBufferData(GL_ARRAY_BUFFER, mesh->normals.size() * sizeof(Vector3), mesh->normals.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vector3), nullptr);
+		glEnableVertexAttribArray(1);
+
+		if (!mesh->tcoords.empty())
+		{
+			glGenBuffers(1, &tbo);
+			glBindBuffer(GL_ARRAY_BUFFER, tbo);
+			glBufferData(GL_ARRAY_BUFFER, mesh->tcoords.size() * sizeof(Vector2), mesh->tcoords.data(), GL_STATIC_DRAW);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vector2), nullptr);
+			glEnableVertexAttribArray(2);
+		}
 	}
 	
 	if (!mesh->indices.empty())
 	{
+		// Upload the narrowest index type that can address every vertex to save bandwidth
+		GLenum indexType = IndexType(mesh->positions.size());
+		std::vector<uint8_t> indices = PackIndices(mesh->indices, indexType);
+
+		// Every LOD shares the vertices, so their indices follow the full mesh's in the same buffer
+		for (MeshLod& lod : mesh->lods)
+		{
+			std::vector<uint8_t> lodIndices = PackIndices(lod.indices, indexType);
+			lod.offset = indices.size();
+			indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		}
+
 		glGenBuffers(1, &ebo);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(uint16_t), mesh->indices.data(), GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW);
+		mesh->indexType = indexType;
 	}
 
-	glBindVertexArray(GL_NONE);
+	// Room for one command per meshlet, refilled with the visible ones every draw. Not worth it for a single meshlet
+	if (mesh->meshlets.size() > 1)
+	{
+		glGenBuffers(1, &dbo);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, dbo);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, mesh->meshlets.size() * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, GL_NONE);
+	}
+
+	BindVertexArray(GL_NONE);
 	glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_NONE);
 
@@ -173,7 +941,208 @@ void Upload(Mesh* mesh)
 	mesh->pbo = pbo;
 	mesh->nbo = nbo;
 	mesh->tbo = tbo;
+	mesh->vbo = vbo;
 	mesh->ebo = ebo;
+	mesh->dbo = dbo;
+}
+
+GLenum IndexType(size_t vertexCount)
+{
+	if (vertexCount <= UINT8_MAX + 1)
+		return GL_UNSIGNED_BYTE;
+	if (vertexCount <= UINT16_MAX + 1)
+		return GL_UNSIGNED_SHORT;
+	return GL_UNSIGNED_INT;
+}
+
+size_t IndexSize(GLenum type)
+{
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE:
+		return sizeof(uint8_t);
+	case GL_UNSIGNED_SHORT:
+		return sizeof(uint16_t);
+	case GL_UNSIGNED_INT:
+		return sizeof(uint32_t);
+	default:
+		assert(false && "Invalid index type");
+		return 0;
+	}
+}
+
+void PrintLods(const Mesh& mesh, const char* name)
+{
+	for (size_t i = 0; i < mesh.lods.size(); i++)
+	{
+		const MeshLod& lod = mesh.lods[i];
+		printf("Mesh %s: LOD %zu has %zu triangles (%.1f%%), RMS error %f\n", name, i + 1, lod.indices.size() / 3,
+			100.0f * (float)lod.indices.size() / (float)mesh.indices.size(), lod.rmsError);
+	}
+}
+
+// Convert our 32-bit CPU indices to the raw bytes of the given GPU index type
+std::vector<uint8_t> PackIndices(const std::vector<uint32_t>& indices, GLenum type)
+{
+	size_t size = IndexSize(type);
+	std::vector<uint8_t> bytes(indices.size() * size);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE:
+			bytes[i] = indices[i];
+			break;
+		case GL_UNSIGNED_SHORT:
+			((uint16_t*)bytes.data())[i] = indices[i];
+			break;
+		case GL_UNSIGNED_INT:
+			((uint32_t*)bytes.data())[i] = indices[i];
+			break;
+		}
+	}
+	return bytes;
+}
+
+size_t VertexSize(const Mesh& mesh)
+{
+	if (mesh.format == VERTEX_PACKED)
+		return sizeof(PackedVertex);
+	return sizeof(Vector3) * 2 + (mesh.tcoords.empty() ? 0 : sizeof(Vector2));
+}
+
+// Signed-normalized 10-bit x, y & z in the GL_INT_2_10_10_10_REV layout (w is unused)
+uint32_t PackNormal(Vector3 normal)
+{
+	auto snorm10 = [](float value)
+	{
+		int i = (int)roundf(Clamp(value, -1.0f, 1.0f) * 511.0f);
+		return (uint32_t)i & 0x3FF;
+	};
+	return snorm10(normal.x) | (snorm10(normal.y) << 10) | (snorm10(normal.z) << 20);
+}
+
+Vector3 UnpackNormal(uint32_t normal)
+{
+	auto snorm10 = [](uint32_t bits)
+	{
+		// Shift the 10 bits to the top of an int so the sign extends on the way back down
+		int i = (int)(bits << 22) >> 22;
+		return fmaxf(i / 511.0f, -1.0f);
+	};
+	return { snorm10(normal), snorm10(normal >> 10), snorm10(normal >> 20) };
+}
+
+// IEEE 754 binary16 with round-to-nearest-even
+uint16_t PackHalf(float value)
+{
+	uint32_t f;
+	memcpy(&f, &value, sizeof(f));
+	uint32_t sign = (f >> 16) & 0x8000;
+	int exponent = (int)((f >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = f & 0x7FFFFF;
+
+	// NaN & infinity
+	if (((f >> 23) & 0xFF) == 0xFF)
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+
+	// Too large, round to infinity
+	if (exponent >= 31)
+		return sign | 0x7C00;
+
+	// Too small for a normal half, shift into a denormal (or zero)
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return sign;
+		mantissa |= 0x800000;
+		uint32_t shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t middle = 1u << (shift - 1);
+		if (rest > middle || (rest == middle && (half & 1)))
+			half++;
+		return sign | half;
+	}
+
+	uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;	// May carry into the exponent, which correctly rounds up to the next power of 2 (or infinity)
+	return half;
+}
+
+float UnpackHalf(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+
+	uint32_t f;
+	if (exponent == 0)
+	{
+		// Zero or denormal, stored as mantissa * 2^-24
+		float result = mantissa / 16777216.0f;
+		return sign ? -result : result;
+	}
+	else if (exponent == 31)
+	{
+		f = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		f = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	memcpy(&result, &f, sizeof(result));
+	return result;
+}
+
+std::vector<PackedVertex> PackVertices(const Mesh& mesh)
+{
+	std::vector<PackedVertex> vertices(mesh.positions.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		PackedVertex& vertex = vertices[i];
+		vertex.position = mesh.positions[i];
+		vertex.normal = PackNormal(Normalize(mesh.normals[i]));
+		Vector2 tcoord = mesh.tcoords.empty() ? V2_ZERO : mesh.tcoords[i];
+		vertex.tcoord[0] = PackHalf(tcoord.x);
+		vertex.tcoord[1] = PackHalf(tcoord.y);
+	}
+	return vertices;
+}
+
+QuantizationError MeasureQuantizationError(const Mesh& mesh)
+{
+	// Compares against the vertices exactly as they'd be uploaded
+	QuantizationError error;
+	std::vector<PackedVertex> vertices = PackVertices(mesh);
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		Vector3 p = mesh.positions[i];
+		Vector3 q = vertices[i].position;
+		error.position = fmaxf(error.position, fmaxf(fabsf(p.x - q.x), fmaxf(fabsf(p.y - q.y), fabsf(p.z - q.z))));
+	}
+
+	for (size_t i = 0; i < mesh.normals.size(); i++)
+	{
+		Vector3 n = Normalize(mesh.normals[i]);
+		Vector3 q = UnpackNormal(vertices[i].normal);
+		error.normal = fmaxf(error.normal, fmaxf(fabsf(n.x - q.x), fmaxf(fabsf(n.y - q.y), fabsf(n.z - q.z))));
+	}
+
+	// Half floats have relative precision, so measure relative to the magnitude of coordinates outside [-1, 1]
+	for (size_t i = 0; i < mesh.tcoords.size(); i++)
+	{
+		Vector2 t = mesh.tcoords[i];
+		float x = UnpackHalf(vertices[i].tcoord[0]);
+		float y = UnpackHalf(vertices[i].tcoord[1]);
+		error.tcoord = fmaxf(error.tcoord, fabsf(t.x - x) / fmaxf(fabsf(t.x), 1.0f));
+		error.tcoord = fmaxf(error.tcoord, fabsf(t.y - y) / fmaxf(fabsf(t.y), 1.0f));
+	}
+	return error;
 }
 
 void GenCube(Mesh* mesh, float width, float height, float length)
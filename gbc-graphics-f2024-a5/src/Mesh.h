@@ -10,6 +10,73 @@ enum ShapeType
 	SPHERE
 };
 
+enum VertexFormat
+{
+	VERTEX_FLOAT,	// Separate position, normal & tcoord buffers of floats (32 bytes per vertex)
+	VERTEX_PACKED	// One interleaved buffer of PackedVertex (20 bytes per vertex)
+};
+
+// Float position, 10_10_10_2 snorm normal, half-float tcoord
+struct PackedVertex
+{
+	Vector3 position;
+	uint32_t normal;
+	uint16_t tcoord[2];
+};
+
+// Largest round-trip error we accept from vertex quantization. Positions stay floats,
+// 10-bit snorm normals step by 1/511 per component, half floats keep 11 significant bits
+constexpr float POSITION_TOLERANCE = 0.0f;
+constexpr float NORMAL_TOLERANCE = 1.0f / 511.0f;
+constexpr float TCOORD_TOLERANCE = 1.0f / 2048.0f;
+
+// A simplified version of a mesh's triangles that reuses its vertices
+struct MeshLod
+{
+	std::vector<uint32_t> indices;
+	// Largest RMS distance of a collapse's vertex from the area-weighted planes it replaced, summed over the levels
+	// before, relative to the mesh's largest dimension. An average per collapse rather than a bound, so single
+	// vertices can end up further from the full detail surface
+	float rmsError = 0.0f;
+	size_t offset = 0;	// Byte offset of the indices in the mesh's element buffer, set on upload
+};
+
+// A cluster of neighbouring triangles that can be culled as a whole.
+// Its triangles are a contiguous range of the mesh's indices so visible clusters can be drawn indirectly
+struct Meshlet
+{
+	uint32_t offset = 0;	// First index
+	uint32_t count = 0;		// Number of indices
+
+	// Bounding sphere
+	Vector3 center = V3_ZERO;
+	float radius = 0.0f;
+
+	// Normal cone: every triangle faces away from cameras where dot(normalize(apex - camera), axis) >= cutoff
+	Vector3 coneApex = V3_ZERO;
+	Vector3 coneAxis = V3_ZERO;
+	float coneCutoff = 1.0f;
+};
+
+// Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Results of culling a mesh's meshlets
+struct MeshletCullStats
+{
+	int visible = 0;
+	int frustumCulled = 0;
+	int backfaceCulled = 0;
+	int triangles = 0;	// Triangles in visible meshlets
+};
+
 struct Mesh
 {
 	// Number of triangle points in our mesh
@@ -20,18 +87,103 @@ struct Mesh
 	std::vector<Vector3> positions;
 	std::vector<Vector3> normals;
 	std::vector<Vector2> tcoords;
-	std::vector<uint16_t> indices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;	// Coarser levels after indices, least detailed last
+	std::vector<Meshlet> meshlets;	// Clusters of the full detail indices
+
+	// Axis-aligned bounds of positions
+	Vector3 boundsMin = V3_ZERO;
+	Vector3 boundsMax = V3_ZERO;
 
 	// GPU data
 	GLuint vao = GL_NONE;	// Vertex array object
 	GLuint pbo = GL_NONE;	// Position buffer object
 	GLuint nbo = GL_NONE;	// Normals buffer object
 	GLuint tbo = GL_NONE;	// Tcoords buffer object
+	GLuint vbo = GL_NONE;	// Vertex buffer object (interleaved, VERTEX_PACKED only)
 	GLuint ebo = GL_NONE;	// Element buffer object (indices)
+	GLuint dbo = GL_NONE;	// Draw indirect buffer object (visible meshlets)
+
+	// Narrowest of GL_UNSIGNED_BYTE/SHORT/INT that addresses every vertex, chosen on upload
+	GLenum indexType = GL_UNSIGNED_SHORT;
+
+	// Set before CreateMesh to choose how vertices are stored on the GPU
+	VertexFormat format = VERTEX_FLOAT;
+
+	// Set before CreateMesh to skip reordering triangles & vertices for the GPU's vertex cache
+	bool optimize = true;
+
+	// Set before CreateMesh to choose how many levels of detail to generate, including the full mesh
+	int lodCount = 4;
+
+	// Steps that have run on the CPU data, so SaveMeshCache never records a step that didn't
+	bool optimized = false;		// OptimizeMesh
+	bool lodsGenerated = false;	// GenerateLods
 };
 
+// Largest per-component error introduced by packing a mesh's vertices
+struct QuantizationError
+{
+	float position = 0.0f;
+	float normal = 0.0f;
+	float tcoord = 0.0f;	// Relative to the coordinate's magnitude for coordinates outside [-1, 1]
+};
+
+// Loads from path.cache if it's up to date, otherwise parses the obj and writes the cache
 void CreateMesh(Mesh* mesh, const char* path);
 void CreateMesh(Mesh* mesh, ShapeType shape);
 void DestroyMesh(Mesh* mesh);
 
-void DrawMesh(const Mesh& mesh);
\ No newline at end of file
+void DrawMesh(const Mesh& mesh);
+
+// Draws the coarsest level of detail whose RMS error covers less than a pixel of a viewport viewportHeight pixels tall.
+// At full detail only the meshlets that are on screen & facing the camera are drawn
+void DrawMesh(const Mesh& mesh, Matrix world, Matrix view, Matrix proj, float viewportHeight);
+
+// Vertex attribute locations of DrawMeshInstanced's per-instance data. The world matrix takes 4
+constexpr GLuint INSTANCE_WORLD_LOCATION = 3;
+constexpr GLuint INSTANCE_COLOR_LOCATION = 7;
+
+// Draws count copies of the mesh in one call. Their world matrices (& colours unless colors is null, in which case
+// every instance is white) are streamed to per-instance attributes that shaders compiled with INSTANCED read.
+// Level 0 is the full mesh, i > 0 is mesh.lods[i - 1]
+void DrawMeshInstanced(const Mesh& mesh, const Matrix* worlds, const Vector3* colors, int count, int level = 0);
+
+// Appends a draw command for each run of meshlets that is inside the frustum & not facing away from the camera.
+// Cone culling assumes world has a uniform scale
+MeshletCullStats CullMeshlets(const Mesh& mesh, Matrix world, Matrix view, Matrix proj, std::vector<DrawElementsIndirectCommand>* commands);
+
+// Level DrawMesh picks: 0 is the full mesh, i > 0 is mesh.lods[i - 1]
+int SelectLod(const Mesh& mesh, Matrix world, Matrix view, Matrix proj, float viewportHeight);
+
+// Same, given the world matrix's largest axis scale & the view space depth (-z) of the mesh's bounds' center,
+// so callers can transform many objects' centers at once
+int SelectLod(const Mesh& mesh, float scale, float depth, Matrix proj, float viewportHeight);
+
+// CPU-only steps of CreateMesh (no GPU upload)
+// LoadObj parses line-aligned chunks of the file in parallel (threads = 0 uses every core).
+// LoadObjSerial parses with fast_obj on one thread. Both build identical meshes.
+// Both print an error & return false if the file can't be read
+bool LoadObj(Mesh* mesh, const char* path, int threads = 0);
+bool LoadObjSerial(Mesh* mesh, const char* path);
+bool LoadMeshCache(Mesh* mesh, const char* path);
+void SaveMeshCache(const Mesh& mesh, const char* path);
+void ComputeBounds(Mesh* mesh);
+
+// Index type needed to address vertexCount vertices, and its size in bytes
+GLenum IndexType(size_t vertexCount);
+size_t IndexSize(GLenum type);
+
+// Bytes per vertex on the GPU for the mesh's vertex format
+size_t VertexSize(const Mesh& mesh);
+
+uint32_t PackNormal(Vector3 normal);
+Vector3 UnpackNormal(uint32_t normal);
+uint16_t PackHalf(float value);
+float UnpackHalf(uint16_t value);
+
+// The mesh's vertices in the VERTEX_PACKED layout
+std::vector<PackedVertex> PackVertices(const Mesh& mesh);
+
+// Packs the mesh's vertices, unpacks them again & reports the worst error against the originals
+QuantizationError MeasureQuantizationError(const Mesh& mesh);
\ No newline at end of file
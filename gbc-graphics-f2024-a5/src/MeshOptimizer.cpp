@@ -0,0 +1,748 @@
+#include "MeshOptimizer.h"
+#include "Mesh.h"
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+// Forsyth's recommended tuning, see https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+constexpr int FORSYTH_CACHE_SIZE = 32;
+constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+// How much we want to emit a triangle using this vertex next.
+// Vertices recently used score higher, as do vertices with few triangles left (so they leave the cache for good)
+float ForsythScore(int cachePosition, uint32_t remaining)
+{
+	if (remaining == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// The last triangle's vertices get a fixed score so we don't favour any particular winding
+		if (cachePosition < 3)
+		{
+			score = FORSYTH_LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			float t = 1.0f - (cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3);
+			score = powf(t, FORSYTH_CACHE_DECAY_POWER);
+		}
+	}
+
+	score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remaining, -FORSYTH_VALENCE_BOOST_POWER);
+	return score;
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize)
+{
+	VertexCacheStats stats;
+	if (indices.empty())
+		return stats;
+
+	// A vertex is still cached if fewer than cacheSize misses happened since it was last transformed
+	std::vector<uint32_t> stamps(vertexCount, 0);
+	std::vector<bool> used(vertexCount, false);
+	uint32_t time = cacheSize + 1;
+	uint32_t misses = 0;
+	uint32_t unique = 0;
+	for (uint32_t index : indices)
+	{
+		if (time - stamps[index] > (uint32_t)cacheSize)
+		{
+			stamps[index] = time++;
+			misses++;
+		}
+
+		if (!used[index])
+		{
+			used[index] = true;
+			unique++;
+		}
+	}
+
+	stats.acmr = misses / ((float)indices.size() / 3.0f);
+	stats.atvr = misses / (float)unique;
+	return stats;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>* indices, size_t vertexCount)
+{
+	size_t triangleCount = indices->size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles that use each vertex. A vertex's live triangles are the first remaining[v] of its range
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : *indices)
+		remaining[index]++;
+
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	std::vector<uint32_t> adjacency(indices->size());
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices->size(); i++)
+		adjacency[fill[(*indices)[i]]++] = (uint32_t)(i / 3);
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = ForsythScore(-1, remaining[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* triangle = &(*indices)[t * 3];
+		triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> result;
+	result.reserve(indices->size());
+
+	std::vector<uint32_t> cache, nextCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	size_t cursor = 0;
+	int best = -1;
+	while (result.size() < indices->size())
+	{
+		// Nothing in the cache has triangles left, so continue from the next triangle in the original order
+		if (best < 0)
+		{
+			while (emitted[cursor])
+				cursor++;
+			best = (int)cursor;
+		}
+
+		const uint32_t* triangle = &(*indices)[best * 3];
+		emitted[best] = true;
+		result.insert(result.end(), triangle, triangle + 3);
+
+		// Remove the triangle from its vertices' live triangles
+		for (int i = 0; i < 3; i++)
+		{
+			uint32_t v = triangle[i];
+			uint32_t* live = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				if (live[j] == (uint32_t)best)
+				{
+					live[j] = live[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// The triangle's vertices move to the front of the cache
+		nextCache.assign(triangle, triangle + 3);
+		for (uint32_t v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				nextCache.push_back(v);
+		}
+
+		for (size_t i = FORSYTH_CACHE_SIZE; i < nextCache.size(); i++)
+		{
+			uint32_t v = nextCache[i];
+			cachePositions[v] = -1;
+			vertexScores[v] = ForsythScore(-1, remaining[v]);
+		}
+		if (nextCache.size() > FORSYTH_CACHE_SIZE)
+			nextCache.resize(FORSYTH_CACHE_SIZE);
+		cache.swap(nextCache);
+
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			uint32_t v = cache[i];
+			cachePositions[v] = (int)i;
+			vertexScores[v] = ForsythScore((int)i, remaining[v]);
+		}
+
+		// Only triangles touching the cache changed score, and the best next triangle is one of them
+		best = -1;
+		float bestScore = -1.0f;
+		for (uint32_t v : cache)
+		{
+			const uint32_t* live = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				uint32_t t = live[j];
+				const uint32_t* other = &(*indices)[t * 3];
+				triangleScores[t] = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					best = t;
+				}
+			}
+		}
+	}
+
+	*indices = std::move(result);
+}
+
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>* indices, size_t vertexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t next = 0;
+	for (uint32_t& index : *indices)
+	{
+		if (remap[index] == UINT32_MAX)
+			remap[index] = next++;
+		index = remap[index];
+	}
+
+	// Keep unreferenced vertices, after all the referenced ones
+	for (uint32_t& index : remap)
+	{
+		if (index == UINT32_MAX)
+			index = next++;
+	}
+	return remap;
+}
+
+template<typename T>
+void Reorder(std::vector<T>* values, const std::vector<uint32_t>& remap)
+{
+	if (values->empty())
+		return;
+
+	std::vector<T> result(values->size());
+	for (size_t i = 0; i < values->size(); i++)
+		result[remap[i]] = (*values)[i];
+	*values = std::move(result);
+}
+
+void OptimizeMesh(Mesh* mesh, VertexCacheStats* before, VertexCacheStats* after)
+{
+	assert(!mesh->indices.empty());
+	size_t vertexCount = mesh->positions.size();
+	if (before != nullptr)
+		*before = AnalyzeVertexCache(mesh->indices, vertexCount);
+
+	// Meshlets are grown from the cache-ordered triangles & reorder them again, so vertices are numbered last
+	OptimizeVertexCache(&mesh->indices, vertexCount);
+	mesh->meshlets = BuildMeshlets(&mesh->indices, mesh->positions);
+	std::vector<uint32_t> remap = OptimizeVertexFetch(&mesh->indices, vertexCount);
+	Reorder(&mesh->positions, remap);
+	Reorder(&mesh->normals, remap);
+	Reorder(&mesh->tcoords, remap);
+
+	if (after != nullptr)
+		*after = AnalyzeVertexCache(mesh->indices, vertexCount);
+	mesh->optimized = true;
+}
+
+// Sum of squared distances to a set of planes, weighted by the area of the triangle each plane came from
+struct Quadric
+{
+	float a2 = 0.0f, b2 = 0.0f, c2 = 0.0f, d2 = 0.0f;
+	float ab = 0.0f, ac = 0.0f, ad = 0.0f;
+	float bc = 0.0f, bd = 0.0f, cd = 0.0f;
+	float w = 0.0f;
+};
+
+void AddPlane(Quadric* q, Vector3 n, float d, float w)
+{
+	q->a2 += w * n.x * n.x;
+	q->b2 += w * n.y * n.y;
+	q->c2 += w * n.z * n.z;
+	q->d2 += w * d * d;
+	q->ab += w * n.x * n.y;
+	q->ac += w * n.x * n.z;
+	q->ad += w * n.x * d;
+	q->bc += w * n.y * n.z;
+	q->bd += w * n.y * d;
+	q->cd += w * n.z * d;
+	q->w += w;
+}
+
+void AddQuadric(Quadric* q, const Quadric& other)
+{
+	q->a2 += other.a2;
+	q->b2 += other.b2;
+	q->c2 += other.c2;
+	q->d2 += other.d2;
+	q->ab += other.ab;
+	q->ac += other.ac;
+	q->ad += other.ad;
+	q->bc += other.bc;
+	q->bd += other.bd;
+	q->cd += other.cd;
+	q->w += other.w;
+}
+
+// Area-weighted mean squared distance from p to the quadric's planes
+float Evaluate(const Quadric& q, Vector3 p)
+{
+	float r = q.a2 * p.x * p.x + q.b2 * p.y * p.y + q.c2 * p.z * p.z + q.d2 +
+		2.0f * (q.ab * p.x * p.y + q.ac * p.x * p.z + q.bc * p.y * p.z) +
+		2.0f * (q.ad * p.x + q.bd * p.y + q.cd * p.z);
+	return q.w > 0.0f ? fabsf(r) / q.w : 0.0f;
+}
+
+struct Collapse
+{
+	float cost;
+	uint32_t from, to;
+
+	bool operator<(const Collapse& other) const
+	{
+		if (cost != other.cost)
+			return cost < other.cost;
+		return from != other.from ? from < other.from : to < other.to;
+	}
+};
+
+// Whether moving vertex from onto vertex to turns any of from's other triangles upside down
+bool CollapseFlips(const std::vector<uint32_t>& indices, const uint32_t* triangles, uint32_t triangleCount,
+	const std::vector<Vector3>& positions, uint32_t from, uint32_t to)
+{
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		const uint32_t* triangle = &indices[triangles[i] * 3];
+		int k = triangle[0] == from ? 0 : triangle[1] == from ? 1 : 2;
+		uint32_t a = triangle[(k + 1) % 3];
+		uint32_t b = triangle[(k + 2) % 3];
+
+		// Triangles on the collapsing edge disappear
+		if (a == to || b == to)
+			continue;
+
+		Vector3 before = Cross(positions[a] - positions[from], positions[b] - positions[from]);
+		Vector3 after = Cross(positions[a] - positions[to], positions[b] - positions[to]);
+		if (Dot(before, after) <= 0.0f)
+			return true;
+	}
+	return false;
+}
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<uint32_t>& indices, const std::vector<Vector3>& positions,
+	size_t targetIndexCount, float maxError, float* rmsError)
+{
+	size_t vertexCount = positions.size();
+	std::vector<uint32_t> result = indices;
+	float resultError = 0.0f;
+
+	// Work in a unit box so errors don't depend on the mesh's scale
+	Vector3 boundsMin = positions.empty() ? V3_ZERO : positions[0];
+	Vector3 boundsMax = boundsMin;
+	for (const Vector3& position : positions)
+	{
+		boundsMin = Min(boundsMin, position);
+		boundsMax = Max(boundsMax, position);
+	}
+	Vector3 size = boundsMax - boundsMin;
+	float extent = std::max(std::max(size.x, size.y), size.z);
+	float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+	std::vector<Vector3> points(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+		points[i] = (positions[i] - boundsMin) * scale;
+
+	// Vertices split by an attribute seam share a position. Group them under their lowest index
+	std::vector<uint32_t> order(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+		order[i] = (uint32_t)i;
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+	{
+		const Vector3& p = positions[a];
+		const Vector3& q = positions[b];
+		if (p.x != q.x) return p.x < q.x;
+		if (p.y != q.y) return p.y < q.y;
+		if (p.z != q.z) return p.z < q.z;
+		return a < b;
+	});
+
+	std::vector<uint32_t> wedge(vertexCount);
+	std::vector<bool> locked(vertexCount, false);
+	for (size_t i = 0; i < vertexCount; )
+	{
+		size_t j = i + 1;
+		while (j < vertexCount &&
+			positions[order[j]].x == positions[order[i]].x &&
+			positions[order[j]].y == positions[order[i]].y &&
+			positions[order[j]].z == positions[order[i]].z)
+			j++;
+		for (size_t k = i; k < j; k++)
+		{
+			wedge[order[k]] = order[i];
+			locked[order[k]] = j - i > 1;
+		}
+		i = j;
+	}
+
+	// Edges used by one triangle are open borders, edges used by more than two are non-manifold. Lock both
+	std::vector<uint64_t> edges;
+	edges.reserve(result.size());
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t a = wedge[result[i + k]];
+			uint32_t b = wedge[result[i + (k + 1) % 3]];
+			edges.push_back(((uint64_t)std::min(a, b) << 32) | std::max(a, b));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i < edges.size(); )
+	{
+		size_t j = i + 1;
+		while (j < edges.size() && edges[j] == edges[i])
+			j++;
+		if (j - i != 2)
+		{
+			locked[edges[i] >> 32] = true;
+			locked[edges[i] & 0xFFFFFFFF] = true;
+		}
+		i = j;
+	}
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		if (locked[wedge[i]])
+			locked[i] = true;
+	}
+
+	// Each position's quadric holds the planes of every triangle around it
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		Vector3 p0 = points[result[i]];
+		Vector3 p1 = points[result[i + 1]];
+		Vector3 p2 = points[result[i + 2]];
+		Vector3 normal = Cross(p1 - p0, p2 - p0);
+		float area = Length(normal);
+		if (area <= 0.0f)
+			continue;
+
+		normal = normal / area;
+		float d = -Dot(normal, p0);
+		for (int k = 0; k < 3; k++)
+			AddPlane(&quadrics[wedge[result[i + k]]], normal, d, area * 0.5f);
+	}
+
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> offsets(vertexCount + 1), adjacency;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> moved(vertexCount);
+	float maxCost = maxError * maxError;
+
+	// Each pass collapses the cheapest edges whose neighbourhoods don't overlap, then rebuilds the triangles
+	while (result.size() > targetIndexCount)
+	{
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (uint32_t index : result)
+			offsets[index + 1]++;
+		for (size_t i = 0; i < vertexCount; i++)
+			offsets[i + 1] += offsets[i];
+		adjacency.resize(result.size());
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacency[fill[result[i]]++] = (uint32_t)(i / 3);
+
+		// Only unlocked vertices move, and they always move onto a neighbour so no new positions are created
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t from = result[i + k];
+				uint32_t to = result[i + (k + 1) % 3];
+				for (int direction = 0; direction < 2; direction++)
+				{
+					if (!locked[from])
+					{
+						Quadric q = quadrics[wedge[from]];
+						AddQuadric(&q, quadrics[wedge[to]]);
+						collapses.push_back({ Evaluate(q, points[to]), from, to });
+					}
+					std::swap(from, to);
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end());
+		collapses.erase(std::unique(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+		{
+			return a.from == b.from && a.to == b.to;
+		}), collapses.end());
+
+		for (size_t i = 0; i < vertexCount; i++)
+			remap[i] = (uint32_t)i;
+		std::fill(moved.begin(), moved.end(), false);
+
+		// Each collapse removes about 2 triangles
+		size_t needed = (result.size() - targetIndexCount) / 3;
+		size_t removed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.cost > maxCost || removed >= needed)
+				break;
+
+			uint32_t from = collapse.from;
+			uint32_t to = collapse.to;
+			if (moved[from] || moved[to])
+				continue;
+
+			const uint32_t* triangles = &adjacency[offsets[from]];
+			uint32_t count = offsets[from + 1] - offsets[from];
+			if (CollapseFlips(result, triangles, count, points, from, to))
+				continue;
+
+			// Every triangle around from changes shape, so none of their vertices can move again this pass
+			for (uint32_t j = 0; j < count; j++)
+			{
+				const uint32_t* triangle = &result[triangles[j] * 3];
+				moved[triangle[0]] = moved[triangle[1]] = moved[triangle[2]] = true;
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+					removed++;
+			}
+
+			remap[from] = to;
+			AddQuadric(&quadrics[wedge[to]], quadrics[wedge[from]]);
+			resultError = std::max(resultError, collapse.cost);
+		}
+
+		if (removed == 0)
+			break;
+
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32_t a = remap[result[i]];
+			uint32_t b = remap[result[i + 1]];
+			uint32_t c = remap[result[i + 2]];
+			if (wedge[a] == wedge[b] || wedge[b] == wedge[c] || wedge[a] == wedge[c])
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	if (rmsError != nullptr)
+		*rmsError = sqrtf(resultError);
+	return result;
+}
+
+void GenerateLods(Mesh* mesh, int lodCount)
+{
+	mesh->lods.clear();
+	mesh->lodsGenerated = true;
+	if (mesh->indices.empty())
+		return;
+
+	const std::vector<uint32_t>* previous = &mesh->indices;
+	float previousError = 0.0f;
+	for (int level = 1; level < lodCount; level++)
+	{
+		// Simplify the previous level. Its error adds to ours since we only measure distance to its surface
+		size_t target = previous->size() / 6 * 3;
+		MeshLod lod;
+		lod.indices = SimplifyMesh(*previous, mesh->positions, target, LOD_MAX_ERROR - previousError, &lod.rmsError);
+		lod.rmsError += previousError;
+
+		// Stop once locked borders & seams keep us from removing at least a tenth of the triangles
+		if (lod.indices.empty() || lod.indices.size() > previous->size() * 9 / 10)
+			break;
+
+		assert(lod.indices.size() % 3 == 0 && lod.indices.size() < previous->size());
+		assert(lod.rmsError >= previousError && lod.rmsError <= LOD_MAX_ERROR);
+		OptimizeVertexCache(&lod.indices, mesh->positions.size());
+		previousError = lod.rmsError;
+		mesh->lods.push_back(std::move(lod));
+		previous = &mesh->lods.back().indices;
+	}
+}
+
+void ComputeMeshletBounds(Meshlet* meshlet, const std::vector<uint32_t>& indices, const std::vector<Vector3>& positions)
+{
+	const uint32_t* triangles = &indices[meshlet->offset];
+	Vector3 boundsMin = positions[triangles[0]];
+	Vector3 boundsMax = boundsMin;
+	for (uint32_t i = 0; i < meshlet->count; i++)
+	{
+		boundsMin = Min(boundsMin, positions[triangles[i]]);
+		boundsMax = Max(boundsMax, positions[triangles[i]]);
+	}
+
+	meshlet->center = (boundsMin + boundsMax) * 0.5f;
+	meshlet->radius = 0.0f;
+	for (uint32_t i = 0; i < meshlet->count; i++)
+		meshlet->radius = std::max(meshlet->radius, Distance(meshlet->center, positions[triangles[i]]));
+
+	// The cone's axis is the average facing. Its cutoff is the sine of the widest angle any triangle makes with it
+	std::vector<Vector3> normals, corners;
+	normals.reserve(meshlet->count / 3);
+	corners.reserve(meshlet->count / 3);
+	Vector3 axis = V3_ZERO;
+	for (uint32_t i = 0; i < meshlet->count; i += 3)
+	{
+		Vector3 p0 = positions[triangles[i]];
+		Vector3 p1 = positions[triangles[i + 1]];
+		Vector3 p2 = positions[triangles[i + 2]];
+		Vector3 normal = Cross(p1 - p0, p2 - p0);
+		float area = Length(normal);
+		if (area <= 0.0f)
+			continue;
+
+		normals.push_back(normal / area);
+		corners.push_back(p0);
+		axis = axis + normals.back();
+	}
+
+	meshlet->coneApex = meshlet->center;
+	meshlet->coneAxis = V3_ZERO;
+	meshlet->coneCutoff = 1.0f;
+	float length = Length(axis);
+	if (length <= 0.0f)
+		return;
+
+	axis = axis / length;
+	float minDot = 1.0f;
+	for (const Vector3& normal : normals)
+		minDot = std::min(minDot, Dot(normal, axis));
+
+	// Triangles spread over more than a hemisphere (less a margin) never all face away at once, so leave them uncullable
+	if (minDot <= 0.1f)
+		return;
+
+	// Move the apex back along the axis until it's behind every triangle's plane
+	float maxT = 0.0f;
+	for (size_t i = 0; i < normals.size(); i++)
+	{
+		float t = Dot(meshlet->center - corners[i], normals[i]) / Dot(axis, normals[i]);
+		maxT = std::max(maxT, t);
+	}
+
+	meshlet->coneApex = meshlet->center - axis * maxT;
+	meshlet->coneAxis = axis;
+	meshlet->coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+std::vector<Meshlet> BuildMeshlets(std::vector<uint32_t>* indices, const std::vector<Vector3>& positions,
+	size_t maxVertices, size_t maxTriangles)
+{
+	std::vector<Meshlet> meshlets;
+	size_t triangleCount = indices->size() / 3;
+	if (triangleCount == 0)
+		return meshlets;
+
+	// Triangles that use each vertex
+	size_t vertexCount = positions.size();
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (uint32_t index : *indices)
+		offsets[index + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] += offsets[v];
+	std::vector<uint32_t> adjacency(indices->size());
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices->size(); i++)
+		adjacency[fill[(*indices)[i]]++] = (uint32_t)(i / 3);
+
+	std::vector<Vector3> normals(triangleCount, V3_ZERO);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* triangle = &(*indices)[t * 3];
+		Vector3 normal = Cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+		float area = Length(normal);
+		if (area > 0.0f)
+			normals[t] = normal / area;
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> used(vertexCount, UINT32_MAX);	// Meshlet that last used each vertex
+	std::vector<uint32_t> slots(vertexCount);	// Index of each vertex within its meshlet
+	std::vector<uint32_t> vertices, local, result;
+	vertices.reserve(maxVertices);
+	result.reserve(indices->size());
+
+	size_t cursor = 0;
+	while (result.size() < indices->size())
+	{
+		// Grow each meshlet from the next unused triangle, always adding the neighbour that needs the fewest new
+		// vertices & faces the same way as the meshlet so far. Tight, flat meshlets cull best
+		uint32_t id = (uint32_t)meshlets.size();
+		Meshlet meshlet;
+		meshlet.offset = (uint32_t)result.size();
+		vertices.clear();
+		Vector3 facing = V3_ZERO;
+
+		while (emitted[cursor])
+			cursor++;
+		uint32_t next = (uint32_t)cursor;
+		while (true)
+		{
+			const uint32_t* triangle = &(*indices)[next * 3];
+			emitted[next] = true;
+			result.insert(result.end(), triangle, triangle + 3);
+			meshlet.count += 3;
+			facing = facing + normals[next];
+			for (int k = 0; k < 3; k++)
+			{
+				if (used[triangle[k]] != id)
+				{
+					used[triangle[k]] = id;
+					vertices.push_back(triangle[k]);
+				}
+			}
+
+			if (meshlet.count / 3 == maxTriangles)
+				break;
+
+			int bestNew = 3;
+			float bestDot = -2.0f;
+			uint32_t best = UINT32_MAX;
+			for (uint32_t v : vertices)
+			{
+				for (uint32_t j = offsets[v]; j < offsets[v + 1]; j++)
+				{
+					uint32_t t = adjacency[j];
+					if (emitted[t])
+						continue;
+
+					const uint32_t* candidate = &(*indices)[t * 3];
+					int added = (used[candidate[0]] != id) + (used[candidate[1]] != id) + (used[candidate[2]] != id);
+					if (vertices.size() + added > maxVertices)
+						continue;
+
+					float dot = Dot(normals[t], facing);
+					if (added < bestNew || (added == bestNew && (dot > bestDot || (dot == bestDot && t < best))))
+					{
+						bestNew = added;
+						bestDot = dot;
+						best = t;
+					}
+				}
+			}
+
+			if (best == UINT32_MAX)
+				break;
+			next = best;
+		}
+
+		// Reorder the meshlet's own triangles for the vertex cache, numbering its vertices 0 to n - 1 meanwhile
+		for (size_t i = 0; i < vertices.size(); i++)
+			slots[vertices[i]] = (uint32_t)i;
+		local.clear();
+		for (size_t i = meshlet.offset; i < result.size(); i++)
+			local.push_back(slots[result[i]]);
+		OptimizeVertexCache(&local, vertices.size());
+		for (size_t i = 0; i < local.size(); i++)
+			result[meshlet.offset + i] = vertices[local[i]];
+		meshlets.push_back(meshlet);
+	}
+
+	*indices = std::move(result);
+	for (Meshlet& meshlet : meshlets)
+		ComputeMeshletBounds(&meshlet, *indices, positions);
+	return meshlets;
+}
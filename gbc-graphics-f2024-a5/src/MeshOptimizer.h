@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Math.h"
+
+struct Mesh;
+struct Meshlet;
+
+// Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats
+{
+	float acmr = 0.0f;	// Average cache miss ratio: vertex shader runs per triangle (0.5 is ideal, 3 is the worst)
+	float atvr = 0.0f;	// Average transformed vertex ratio: vertex shader runs per vertex (1 is ideal)
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 16);
+
+// Reorders triangles so consecutive triangles share vertices (Tom Forsyth's linear-speed vertex cache optimization)
+void OptimizeVertexCache(std::vector<uint32_t>* indices, size_t vertexCount);
+
+// Renumbers vertices in the order the indices first use them so vertex fetches walk memory linearly.
+// Returns the remap table: new index = remap[old index]
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>* indices, size_t vertexCount);
+
+// Runs both optimizations on an indexed mesh's CPU data & builds its meshlets between them, so the vertex order
+// follows the meshlets' final index order. Call before uploading
+void OptimizeMesh(Mesh* mesh, VertexCacheStats* before = nullptr, VertexCacheStats* after = nullptr);
+
+// Collapses edges in order of least quadric error until about targetIndexCount indices remain or the next collapse
+// would exceed maxError. Border & attribute seam vertices never move, so silhouettes and UV/normal seams don't tear.
+// Errors are the RMS distance of a collapse from its area-weighted planes (an average, not a bound), relative to the
+// mesh's largest dimension. rmsError gets the largest collapse's. Deterministic: the same input always gives the same output.
+std::vector<uint32_t> SimplifyMesh(const std::vector<uint32_t>& indices, const std::vector<Vector3>& positions,
+	size_t targetIndexCount, float maxError, float* rmsError = nullptr);
+
+// Coarsest LOD's RMS error may be at most 5% of the mesh's size
+constexpr float LOD_MAX_ERROR = 0.05f;
+
+// Fills mesh->lods with up to lodCount - 1 levels, each with about half the triangles of the one before. Levels stop
+// before their rmsError would pass LOD_MAX_ERROR
+void GenerateLods(Mesh* mesh, int lodCount);
+
+// Groups neighbouring triangles into meshlets of at most maxVertices unique vertices & maxTriangles triangles,
+// reordering indices so each meshlet's triangles are contiguous, then bounds each meshlet
+std::vector<Meshlet> BuildMeshlets(std::vector<uint32_t>* indices, const std::vector<Vector3>& positions,
+	size_t maxVertices = 64, size_t maxTriangles = 124);
@@ -0,0 +1,122 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include <algorithm>
+#include <functional>
+
+uint64_t SortKey(const Material& material, const Mesh& mesh)
+{
+	uint64_t program = material.program->id & 0xFFFF;
+	uint64_t texture = material.texture & 0xFFFF;
+	uint64_t vao = mesh.vao & 0xFFFF;
+	return program << 48 | texture << 32 | vao << 16 | (uint64_t)material.wireframe;
+}
+
+void SubmitDraw(RenderQueue* queue, const Material* material, const Mesh* mesh, Matrix world, Matrix normal)
+{
+	queue->packets.push_back({ SortKey(*material, *mesh), material, mesh, world, normal });
+}
+
+// Binds needed to draw packets in order, starting from nothing bound & filled polygons
+static RenderQueueStats CountChanges(const std::vector<DrawPacket>& packets)
+{
+	RenderQueueStats stats;
+	const Program* program = nullptr;
+	GLuint texture = GL_NONE;
+	GLuint vao = GL_NONE;
+	bool wireframe = false;
+	for (const DrawPacket& packet : packets)
+	{
+		const Material& material = *packet.material;
+		stats.programChanges += material.program != program;
+		stats.textureChanges += material.texture != GL_NONE && material.texture != texture;
+		stats.vaoChanges += packet.mesh->vao != vao;
+		stats.polygonModeChanges += material.wireframe != wireframe;
+
+		program = material.program;
+		texture = material.texture != GL_NONE ? material.texture : texture;
+		vao = packet.mesh->vao;
+		wireframe = material.wireframe;
+	}
+	stats.draws = (int)packets.size();
+	stats.changes = stats.programChanges + stats.textureChanges + stats.vaoChanges + stats.polygonModeChanges;
+	return stats;
+}
+
+void DrawRenderQueue(RenderQueue* queue, Matrix view, Matrix proj, float viewportHeight)
+{
+	std::vector<DrawPacket>& packets = queue->packets;
+	int unsortedChanges = CountChanges(packets).changes;
+
+	// Materials & meshes with equal keys (same state, different colors or regions) are kept together so they don't
+	// interleave & split instanced runs. Stable so packets of the same material & mesh keep their submission order
+	std::stable_sort(packets.begin(), packets.end(), [](const DrawPacket& a, const DrawPacket& b)
+	{
+		if (a.key != b.key)
+			return a.key < b.key;
+		if (a.material != b.material)
+			return std::less<const Material*>()(a.material, b.material);
+		return std::less<const Mesh*>()(a.mesh, b.mesh);
+	});
+
+	// Without a queue every draw bound its program, VAO & polygon mode (& texture if it had one)
+	queue->stats = CountChanges(packets);
+	queue->stats.unsortedChanges = unsortedChanges;
+	int perDraw = 0;
+	for (const DrawPacket& packet : packets)
+		perDraw += packet.material->texture != GL_NONE ? 4 : 3;
+	queue->stats.avoided = perDraw - queue->stats.changes;
+
+	// Every packet's MVP in one batch. Instanced runs multiply by u_viewProj in the shader instead
+	Matrix viewProj = view * proj;
+	static std::vector<Matrix> worlds, mvps;
+	worlds.clear();
+	for (const DrawPacket& packet : packets)
+		worlds.push_back(packet.world);
+	mvps.resize(worlds.size());
+	MultiplyMatrices(worlds.data(), viewProj, mvps.data(), worlds.size());
+
+	// Sorted packets share state with their neighbours, so most of these binds are filtered by GLState
+	for (size_t first = 0; first < packets.size();)
+	{
+		const DrawPacket& packet = packets[first];
+		const Material& material = *packet.material;
+		size_t last = first + 1;
+		while (last < packets.size() && packets[last].material == packet.material && packets[last].mesh == packet.mesh)
+			last++;
+
+		bool instanced = material.instancedProgram != nullptr && last - first > 1;
+		Program* program = instanced ? material.instancedProgram : material.program;
+		UseProgram(program);
+		if (material.texture != GL_NONE)
+			BindTexture(0, material.texture);
+		SetPolygonMode(material.wireframe ? GL_LINE : GL_FILL);
+		SetUniform(program, U_COLOR, material.color);
+		if (material.texture != GL_NONE)
+			SetUniform(program, U_TEX, 0);
+		SetUniform(program, U_ATLAS_RECT, material.region.rect);
+		SetUniform(program, U_ATLAS_LAYER, material.region.layer);
+
+		if (instanced)
+		{
+			SetUniform(program, U_VIEW_PROJ, viewProj);
+			DrawMeshInstanced(*packet.mesh, worlds.data() + first, nullptr, (int)(last - first));
+			queue->stats.drawCalls++;
+			first = last;
+			continue;
+		}
+
+		for (; first < last; first++)
+		{
+			const DrawPacket& packet = packets[first];
+			SetUniform(program, U_MVP, mvps[first]);
+			SetUniform(program, U_WORLD, packet.world);
+			SetUniform(program, U_NORMAL, packet.normal);
+
+			// DrawMesh binds the mesh's VAO
+			DrawMesh(*packet.mesh, packet.world, view, proj, viewportHeight);
+			queue->stats.drawCalls++;
+		}
+	}
+	SetPolygonMode(GL_FILL);
+	packets.clear();
+}
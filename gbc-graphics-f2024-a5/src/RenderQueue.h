@@ -0,0 +1,60 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "Math.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "TextureAtlas.h"
+
+// Everything about a draw other than its mesh & transform
+struct Material
+{
+	Program* program = nullptr;
+	Program* instancedProgram = nullptr;	// If set, runs of packets with this material & the same mesh are one draw
+	GLuint texture = GL_NONE;	// Bound to unit 0 & set as u_tex unless GL_NONE
+	AtlasRegion region;			// u_atlasRect & u_atlasLayer, if texture is a TextureAtlas. Materials sharing an atlas share its bind
+	Vector3 color = V3_ONE;		// u_color, for programs that have it
+	bool wireframe = false;
+};
+
+struct DrawPacket
+{
+	uint64_t key;	// Packets are drawn in increasing key order
+	const Material* material;
+	const Mesh* mesh;
+	Matrix world;
+	Matrix normal;
+};
+
+// Last DrawRenderQueue's state changes (program, texture, VAO & polygon mode binds)
+struct RenderQueueStats
+{
+	int draws = 0;
+	int drawCalls = 0;			// Less than draws when packets are instanced
+	int programChanges = 0;
+	int textureChanges = 0;
+	int vaoChanges = 0;
+	int polygonModeChanges = 0;
+	int changes = 0;			// Sum of the above
+	int unsortedChanges = 0;	// Changes drawing in submission order would have needed
+	int avoided = 0;			// Changes binding every packet's state before its draw would have added
+};
+
+// Draws submitted over a frame, sorted so packets that share state are drawn together
+struct RenderQueue
+{
+	std::vector<DrawPacket> packets;
+	RenderQueueStats stats;
+};
+
+// Program in the top 16 bits, then texture, then VAO, then polygon mode. Sorting by key groups packets by the most
+// expensive state first. Handles above 16 bits only make the grouping less tight; changes are still found exactly
+uint64_t SortKey(const Material& material, const Mesh& mesh);
+
+void SubmitDraw(RenderQueue* queue, const Material* material, const Mesh* mesh, Matrix world, Matrix normal);
+
+// Sorts & draws every packet, then empties the queue. Sets u_mvp, u_world, u_normal, u_color, u_tex & the atlas region
+// (u_viewProj rather than the per-packet matrices when instanced). Leaves the polygon mode filled.
+// viewportHeight picks each mesh's level of detail
+void DrawRenderQueue(RenderQueue* queue, Matrix view, Matrix proj, float viewportHeight);
@@ -0,0 +1,862 @@
+#include "Shader.h"
+#include "File.h"
+#include "GLState.h"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <future>
+#include <list>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// From GL_KHR_parallel_shader_compile, which our glad loader wasn't generated with
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Same order as the Uniform enum
+static const char* UNIFORM_NAMES[UNIFORM_COUNT] =
+{
+	"u_mvp",
+	"u_viewProj",
+	"u_world",
+	"u_normal",
+	"u_color",
+	"u_tex",
+	"u_tex0",
+	"u_tex1",
+	"u_t",
+	"u_a",
+	"u_cubemap",
+	"u_atlasRect",
+	"u_atlasLayer"
+};
+
+UniformStats gUniformStats;
+ProgramCacheStats gProgramCacheStats;
+
+// Programs submitted by CreatePrograms whose status hasn't been checked yet
+static std::vector<Program*> gPendingPrograms;
+
+GLuint CreateShader(GLint type, const char* path)
+{
+	GLuint shader = GL_NONE;
+	try
+	{
+		// Load text file
+		std::ifstream file;
+		file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		file.open(path);
+
+		// Interpret the file as a giant string
+		std::stringstream stream;
+		stream << file.rdbuf();
+		file.close();
+
+		// Verify shader type matches shader file extension
+		const char* ext = strrchr(path, '.');
+		switch (type)
+		{
+		case GL_VERTEX_SHADER:
+			assert(strcmp(ext, ".vert") == 0);
+			break;
+
+		case GL_FRAGMENT_SHADER:
+			assert(strcmp(ext, ".frag") == 0);
+			break;
+		default:
+			assert(false, "Invalid shader type");
+			break;
+		}
+
+		// Compile text as a shader
+		std::string str = stream.str();
+		const char* src = str.c_str();
+		shader = glCreateShader(type);
+		glShaderSource(shader, 1, &src, NULL);
+		glCompileShader(shader);
+
+		// Check for compilation errors
+		GLint success;
+		GLchar infoLog[512];
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shader, 512, NULL, infoLog);
+			std::cout << "Shader failed to compile: \n" << infoLog << std::endl;
+		}
+	}
+	catch (std::ifstream::failure& e)
+	{
+		std::cout << "Shader (" << path << ") not found: " << e.what() << std::endl;
+		assert(false);
+	}
+
+	return shader;
+}
+
+// Links vs & fs. Retrievable programs can be saved with glGetProgramBinary
+static GLuint LinkProgram(GLuint vs, GLuint fs, bool retrievable)
+{
+	GLuint program = glCreateProgram();
+	if (retrievable)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glLinkProgram(program);
+
+	// Check for linking errors
+	int success;
+	char infoLog[512];
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		glDeleteProgram(program);
+		program = GL_NONE;
+	}
+
+	return program;
+}
+
+GLuint CreateProgram(GLuint vs, GLuint fs)
+{
+	return LinkProgram(vs, fs, false);
+}
+
+// Fills the program's uniform table from its active uniforms
+static void ReflectUniforms(Program* program)
+{
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(program->id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program->id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	// Max length includes the null terminator
+	std::vector<char> buffer(std::max(maxLength, 1));
+	for (GLint i = 0; i < count; i++)
+	{
+		char* name = buffer.data();
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveUniform(program->id, i, (GLsizei)buffer.size(), nullptr, &size, &type, name);
+
+		// Uniform block members & built-ins have no location of their own
+		GLuint index = i;
+		GLint block = -1;
+		glGetActiveUniformsiv(program->id, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block);
+		if (block != -1 || strncmp(name, "gl_", 3) == 0)
+			continue;
+
+		// Arrays are named after their first element
+		char* bracket = strchr(name, '[');
+		if (bracket != nullptr)
+			*bracket = '\0';
+
+		int uniform = 0;
+		while (uniform < UNIFORM_COUNT && strcmp(name, UNIFORM_NAMES[uniform]) != 0)
+			uniform++;
+
+		if (uniform == UNIFORM_COUNT)
+		{
+			printf("Program %u: uniform %s isn't in the Uniform enum so can't be set\n", program->id, name);
+			continue;
+		}
+
+		UniformSlot& slot = program->uniforms[uniform];
+		slot.location = glGetUniformLocation(program->id, name);
+		slot.type = type;
+		gUniformStats.lookups++;
+	}
+}
+
+void CreateProgram(Program* program, GLuint vs, GLuint fs)
+{
+	*program = Program{};
+	program->id = CreateProgram(vs, fs);
+	if (program->id != GL_NONE)
+		ReflectUniforms(program);
+}
+
+// Program binary cache layout: ProgramCacheHeader then the driver's binary
+struct ProgramCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;		// Hash of both sources & the driver's vendor, renderer & version strings
+	uint32_t format;	// From glGetProgramBinary
+	uint32_t size;
+};
+
+constexpr uint32_t PROGRAM_CACHE_MAGIC = 0x474F5250;	// "PROG"
+constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// Cached next to the fragment shader, eg assets/shaders/default+skybox.program.
+// Variants add a hash of their defines, eg assets/shaders/default+phong.3f2a91c4.program
+static std::string ProgramCachePath(const std::string& vs, const std::string& fs, const std::string& defines)
+{
+	size_t vsStart = vs.find_last_of("/\\") + 1;
+	size_t fsStart = fs.find_last_of("/\\") + 1;
+	std::string vsName = vs.substr(vsStart, vs.find_last_of('.') - vsStart);
+	std::string fsName = fs.substr(fsStart, fs.find_last_of('.') - fsStart);
+	std::string path = fs.substr(0, fsStart) + vsName + "+" + fsName;
+	if (!defines.empty())
+	{
+		char hash[16];
+		snprintf(hash, sizeof(hash), ".%08x", (uint32_t)HashBytes(defines.data(), defines.size()));
+		path += hash;
+	}
+	return path + ".program";
+}
+
+// Defines go after the #version line, which must come first
+static std::vector<uint8_t> InsertDefines(const std::vector<uint8_t>& source, const std::string& defines)
+{
+	if (defines.empty())
+		return source;
+
+	std::vector<uint8_t> result = source;
+	std::vector<uint8_t>::iterator line = std::find(result.begin(), result.end(), '\n');
+	if (line != result.end())
+		line++;
+	result.insert(line, defines.begin(), defines.end());
+	return result;
+}
+
+// A binary is only valid for the exact sources & driver it came from
+static uint64_t ProgramCacheKey(const std::vector<uint8_t>& vsSource, const std::vector<uint8_t>& fsSource)
+{
+	uint64_t key = HashBytes(vsSource.data(), vsSource.size());
+	key = HashBytes(fsSource.data(), fsSource.size(), key);
+	const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (GLenum name : strings)
+	{
+		const char* str = (const char*)glGetString(name);
+		key = HashBytes(str, strlen(str) + 1, key);
+	}
+	return key;
+}
+
+static GLuint LoadProgramCache(const char* path, uint64_t key)
+{
+	std::vector<uint8_t> bytes;
+	if (!ReadFile(path, &bytes) || bytes.size() < sizeof(ProgramCacheHeader))
+		return GL_NONE;
+
+	ProgramCacheHeader header{};
+	memcpy(&header, bytes.data(), sizeof(header));
+	if (header.magic != PROGRAM_CACHE_MAGIC || header.version != PROGRAM_CACHE_VERSION || header.key != key ||
+		bytes.size() != sizeof(header) + header.size)
+		return GL_NONE;
+
+	// The driver may still reject it (ie it was updated without changing its version string)
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.format, bytes.data() + sizeof(header), header.size);
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program);
+		return GL_NONE;
+	}
+	return program;
+}
+
+static void SaveProgramCache(const char* path, uint64_t key, GLuint program)
+{
+	GLint size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0)
+		return;
+
+	std::vector<uint8_t> binary(size);
+	GLenum format = GL_NONE;
+	glGetProgramBinary(program, size, &size, &format, binary.data());
+
+	ProgramCacheHeader header{};
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.version = PROGRAM_CACHE_VERSION;
+	header.key = key;
+	header.format = format;
+	header.size = size;
+
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr)
+	{
+		printf("**Warning: could not write program cache %s**\n", path);
+		return;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(binary.data(), 1, size, file);
+	fclose(file);
+}
+
+// Whether the driver can compile in the background & report when it's done (GL_COMPLETION_STATUS_KHR).
+// Its default thread count is already the driver's maximum so glMaxShaderCompilerThreadsKHR isn't needed
+static bool HasParallelCompile()
+{
+	static int supported = -1;
+	if (supported == -1)
+	{
+		supported = 0;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0)
+				supported = 1;
+		}
+	}
+	return supported == 1;
+}
+
+// Queues a compile without waiting for it. Programs check the result once linked
+static GLuint SubmitShader(GLenum type, const std::vector<uint8_t>& source)
+{
+	const char* src = (const char*)source.data();
+	GLint length = (GLint)source.size();
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &src, &length);
+	glCompileShader(shader);
+	return shader;
+}
+
+static void PrintCompileErrors(GLuint shader, const std::string& path)
+{
+	GLint success = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		GLchar infoLog[512];
+		glGetShaderInfoLog(shader, 512, NULL, infoLog);
+		std::cout << "Shader (" << path << ") failed to compile: \n" << infoLog << std::endl;
+	}
+}
+
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// A shader file compiled once for every program that uses it. Kept while shaders are watched so a reload only
+// recompiles the file that changed
+struct Stage
+{
+	std::string path;
+	std::string defines;
+	GLenum type;
+	GLuint id;
+	std::vector<uint8_t> source;	// With defines inserted. Hashed into the program cache key
+};
+
+static std::list<Stage> gStages;
+static std::vector<Program*> gPrograms;	// Every program created from paths
+static DirectoryWatcher* gShaderWatcher = nullptr;
+
+// The stage compiled from path with defines, submitting source (or the file's contents if null) if there isn't one yet
+static Stage* GetStage(const std::string& path, const std::string& defines, GLenum type, const std::vector<uint8_t>* source = nullptr)
+{
+	for (Stage& stage : gStages)
+	{
+		if (stage.path == path && stage.defines == defines)
+			return &stage;
+	}
+
+	std::vector<uint8_t> bytes;
+	if (source != nullptr)
+		bytes = *source;
+	else if (!ReadFile(path.c_str(), &bytes))
+	{
+		printf("**Warning: could not read shader %s**\n", path.c_str());
+		return nullptr;
+	}
+
+	bytes = InsertDefines(bytes, defines);
+	GLuint id = SubmitShader(type, bytes);
+	gStages.push_back(Stage{ path, defines, type, id, std::move(bytes) });
+	return &gStages.back();
+}
+
+// Deletes every stage once nothing can link them again
+static void ReleaseStages()
+{
+	if (gShaderWatcher != nullptr || !gPendingPrograms.empty())
+		return;
+	for (Program* program : gPrograms)
+	{
+		if (program->build.next != GL_NONE)
+			return;
+	}
+
+	for (Stage& stage : gStages)
+		glDeleteShader(stage.id);
+	gStages.clear();
+}
+
+// Checks the link of program (waiting for the driver if it isn't done), printing why it failed if it did.
+// Detaches the stages it was linked with
+static bool CheckLink(GLuint program, const ProgramBuild& build)
+{
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		char infoLog[512];
+		PrintCompileErrors(build.vs, build.vsPath);
+		PrintCompileErrors(build.fs, build.fsPath);
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+	}
+	glDetachShader(program, build.vs);
+	glDetachShader(program, build.fs);
+	return success;
+}
+
+// Whether the driver is done with program. Only valid with GL_KHR_parallel_shader_compile
+static bool IsComplete(GLuint program)
+{
+	GLint complete = GL_FALSE;
+	glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete == GL_TRUE;
+}
+
+// Checks the status of a submitted program, then saves its binary & reflects its uniforms
+static void FinishProgram(Program* program)
+{
+	ProgramBuild& build = program->build;
+	build.pending = false;
+	gPendingPrograms.erase(std::remove(gPendingPrograms.begin(), gPendingPrograms.end(), program), gPendingPrograms.end());
+
+	// Cached binaries were checked when loaded
+	if (!build.cached)
+	{
+		if (!CheckLink(program->id, build))
+		{
+			glDeleteProgram(program->id);
+			program->id = GL_NONE;
+		}
+		else if (build.cacheKey != 0)
+		{
+			SaveProgramCache(ProgramCachePath(build.vsPath, build.fsPath, build.defines).c_str(), build.cacheKey, program->id);
+		}
+		build.vs = build.fs = GL_NONE;
+	}
+
+	if (program->id != GL_NONE)
+		ReflectUniforms(program);
+
+	double ms = MillisecondsSince(build.submitted);
+	const char* result = program->id == GL_NONE ? "failed" : build.cached ? "loaded from cache" : "compiled";
+	printf("Program %s + %s: %s, ready %.2f ms after submission\n", build.vsPath.c_str(), build.fsPath.c_str(), result, ms);
+	gProgramCacheStats.readyMs = std::max(gProgramCacheStats.readyMs, ms);
+	if (gPendingPrograms.empty())
+	{
+		printf("Programs: %i of %i loaded from cache, all ready %.2f ms after submission\n",
+			gProgramCacheStats.hits, gProgramCacheStats.programs, gProgramCacheStats.readyMs);
+		ReleaseStages();
+	}
+}
+
+void CreatePrograms(const ProgramDesc* programs, int count)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	gProgramCacheStats.readyMs = 0.0;
+
+	// Programs share most of their shaders so each file is only read once
+	std::vector<const char*> paths;
+	std::vector<int> vsFiles(count), fsFiles(count);
+	for (int i = 0; i < count; i++)
+	{
+		const char* files[] = { programs[i].vsPath, programs[i].fsPath };
+		int* indices[] = { &vsFiles[i], &fsFiles[i] };
+		for (int j = 0; j < 2; j++)
+		{
+			int index = 0;
+			while (index < (int)paths.size() && strcmp(paths[index], files[j]) != 0)
+				index++;
+			if (index == (int)paths.size())
+				paths.push_back(files[j]);
+			*indices[j] = index;
+		}
+	}
+
+	// Files are read in the order programs need them, so the first can be submitted while the rest are loading
+	struct Source
+	{
+		bool found = false;
+		std::vector<uint8_t> bytes;
+	};
+	std::vector<std::promise<Source>> reads(paths.size());
+	std::vector<std::shared_future<Source>> sources;
+	for (std::promise<Source>& read : reads)
+		sources.push_back(read.get_future().share());
+
+	std::thread reader([&paths, &reads]()
+	{
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			Source source;
+			source.found = ReadFile(paths[i], &source.bytes);
+			reads[i].set_value(std::move(source));
+		}
+	});
+
+	// Drivers without binary formats always compile
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+	for (int i = 0; i < count; i++)
+	{
+		Program* program = programs[i].program;
+		*program = Program{};
+		ProgramBuild& build = program->build;
+		build.vsPath = programs[i].vsPath;
+		build.fsPath = programs[i].fsPath;
+		build.defines = programs[i].defines != nullptr ? programs[i].defines : "";
+		build.submitted = start;
+		if (std::find(gPrograms.begin(), gPrograms.end(), program) == gPrograms.end())
+			gPrograms.push_back(program);
+		gProgramCacheStats.programs++;
+
+		const Source& vsSource = sources[vsFiles[i]].get();
+		const Source& fsSource = sources[fsFiles[i]].get();
+		if (!vsSource.found || !fsSource.found)
+		{
+			std::cout << "Shader (" << (vsSource.found ? build.fsPath : build.vsPath) << ") not found" << std::endl;
+			assert(false);
+			continue;
+		}
+
+		// Binaries are linked as they're loaded, so only compiled programs are left pending
+		if (formats > 0)
+		{
+			build.cacheKey = ProgramCacheKey(InsertDefines(vsSource.bytes, build.defines), InsertDefines(fsSource.bytes, build.defines));
+			program->id = LoadProgramCache(ProgramCachePath(build.vsPath, build.fsPath, build.defines).c_str(), build.cacheKey);
+			build.cached = program->id != GL_NONE;
+			gProgramCacheStats.hits += build.cached;
+		}
+
+		if (!build.cached)
+		{
+			build.vs = GetStage(build.vsPath, build.defines, GL_VERTEX_SHADER, &vsSource.bytes)->id;
+			build.fs = GetStage(build.fsPath, build.defines, GL_FRAGMENT_SHADER, &fsSource.bytes)->id;
+			program->id = glCreateProgram();
+			if (build.cacheKey != 0)
+				glProgramParameteri(program->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+			glAttachShader(program->id, build.vs);
+			glAttachShader(program->id, build.fs);
+			glLinkProgram(program->id);
+		}
+
+		build.pending = true;
+		gPendingPrograms.push_back(program);
+	}
+	reader.join();
+
+	gProgramCacheStats.submitMs += MillisecondsSince(start);
+}
+
+void CreateProgram(Program* program, const char* vsPath, const char* fsPath)
+{
+	ProgramDesc desc{ program, vsPath, fsPath };
+	CreatePrograms(&desc, 1);
+	if (program->build.pending)
+		FinishProgram(program);
+}
+
+// Whether the file name part of path is name
+static bool IsFile(const std::string& path, const std::string& name)
+{
+	size_t start = path.find_last_of("/\\") + 1;
+	return path.compare(start, std::string::npos, name) == 0;
+}
+
+// Starts linking a replacement for program from its current stages
+static void SubmitReload(Program* program)
+{
+	ProgramBuild& build = program->build;
+	if (build.next != GL_NONE)
+	{
+		glDeleteProgram(build.next);
+		build.next = GL_NONE;
+	}
+
+	Stage* vs = GetStage(build.vsPath, build.defines, GL_VERTEX_SHADER);
+	Stage* fs = GetStage(build.fsPath, build.defines, GL_FRAGMENT_SHADER);
+	if (vs == nullptr || fs == nullptr)
+		return;
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	build.cacheKey = formats > 0 ? ProgramCacheKey(vs->source, fs->source) : 0;
+	build.vs = vs->id;
+	build.fs = fs->id;
+	build.next = glCreateProgram();
+	if (build.cacheKey != 0)
+		glProgramParameteri(build.next, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(build.next, build.vs);
+	glAttachShader(build.next, build.fs);
+	glLinkProgram(build.next);
+	build.submitted = std::chrono::high_resolution_clock::now();
+}
+
+// Recompiles the stage from a changed file & relinks every program that uses it
+static void ReloadFile(const std::string& name)
+{
+	std::vector<Program*> users;
+	for (Program* program : gPrograms)
+	{
+		if (IsFile(program->build.vsPath, name) || IsFile(program->build.fsPath, name))
+			users.push_back(program);
+	}
+	if (users.empty())
+		return;
+
+	// Their first link must be checked with the stages it was submitted with
+	for (Program* program : users)
+	{
+		if (program->build.pending)
+			FinishProgram(program);
+	}
+
+	// Editors often save without changing anything
+	bool changed = false, compiled = false;
+	for (Stage& stage : gStages)
+	{
+		if (!IsFile(stage.path, name))
+			continue;
+
+		std::vector<uint8_t> source;
+		if (!ReadFile(stage.path.c_str(), &source))
+		{
+			printf("**Warning: could not read shader %s**\n", stage.path.c_str());
+			return;
+		}
+
+		compiled = true;
+		source = InsertDefines(source, stage.defines);
+		if (source == stage.source)
+			continue;
+
+		glDeleteShader(stage.id);
+		stage.id = SubmitShader(stage.type, source);
+		stage.source = std::move(source);
+		changed = true;
+	}
+	if (compiled && !changed)
+		return;
+
+	for (Program* program : users)
+		SubmitReload(program);
+}
+
+// Swaps in a reloaded program, or keeps the current one if the reload failed
+static void FinishReload(Program* program)
+{
+	ProgramBuild& build = program->build;
+	GLuint next = build.next;
+	build.next = GL_NONE;
+
+	if (!CheckLink(next, build))
+	{
+		glDeleteProgram(next);
+		printf("Program %s + %s: reload failed, keeping the previous version\n", build.vsPath.c_str(), build.fsPath.c_str());
+	}
+	else
+	{
+		if (build.cacheKey != 0)
+			SaveProgramCache(ProgramCachePath(build.vsPath, build.fsPath, build.defines).c_str(), build.cacheKey, next);
+
+		ForgetProgram(program->id);
+		glDeleteProgram(program->id);
+		program->id = next;
+		build.cached = false;
+
+		// Locations may have moved & none of the old values were uploaded to the new program
+		for (UniformSlot& slot : program->uniforms)
+			slot = UniformSlot{};
+		ReflectUniforms(program);
+		printf("Program %s + %s: reloaded in %.2f ms\n", build.vsPath.c_str(), build.fsPath.c_str(),
+			MillisecondsSince(build.submitted));
+	}
+	build.vs = build.fs = GL_NONE;
+	ReleaseStages();
+}
+
+void UpdatePrograms()
+{
+	if (gShaderWatcher != nullptr)
+	{
+		for (const std::string& name : PollDirectoryWatcher(gShaderWatcher))
+			ReloadFile(name);
+	}
+
+	// Copied since finishing removes programs from the list
+	std::vector<Program*> pending = gPendingPrograms;
+	for (Program* program : pending)
+	{
+		if (!HasParallelCompile() || IsComplete(program->id))
+			FinishProgram(program);
+	}
+
+	for (Program* program : gPrograms)
+	{
+		GLuint next = program->build.next;
+		if (next != GL_NONE && (!HasParallelCompile() || IsComplete(next)))
+			FinishReload(program);
+	}
+}
+
+void WatchShaders(const char* directory)
+{
+	UnwatchShaders();
+	gShaderWatcher = CreateDirectoryWatcher(directory);
+}
+
+void UnwatchShaders()
+{
+	DestroyDirectoryWatcher(gShaderWatcher);
+	gShaderWatcher = nullptr;
+	ReleaseStages();
+}
+
+bool IsProgramReady(const Program* program)
+{
+	if (!program->build.pending)
+		return true;
+	return HasParallelCompile() && IsComplete(program->id);
+}
+
+void UseProgram(Program* program)
+{
+	if (program->build.pending)
+		FinishProgram(program);
+	BindProgram(program->id);
+}
+
+void DestroyProgram(Program* program)
+{
+	gPendingPrograms.erase(std::remove(gPendingPrograms.begin(), gPendingPrograms.end(), program), gPendingPrograms.end());
+	gPrograms.erase(std::remove(gPrograms.begin(), gPrograms.end(), program), gPrograms.end());
+	glDeleteProgram(program->build.next);
+	ForgetProgram(program->id);
+	glDeleteProgram(program->id);
+	*program = Program{};
+	ReleaseStages();
+}
+
+Program* GetVariant(ProgramVariants* variants, uint32_t features)
+{
+	std::map<uint32_t, Program>::iterator variant = variants->programs.find(features);
+	if (variant != variants->programs.end())
+		return &variant->second;
+
+	PrepareVariants(variants, &features, 1);
+	return &variants->programs[features];
+}
+
+void PrepareVariants(ProgramVariants* variants, const uint32_t* features, int count)
+{
+	std::vector<std::string> defines;
+	std::vector<ProgramDesc> descs;
+	defines.reserve(count);
+	for (int i = 0; i < count; i++)
+	{
+		if (variants->programs.count(features[i]) > 0)
+			continue;
+		defines.push_back(variants->defines(features[i]));
+		descs.push_back({ &variants->programs[features[i]], variants->vsPath, variants->fsPath, defines.back().c_str() });
+	}
+	if (!descs.empty())
+		CreatePrograms(descs.data(), (int)descs.size());
+}
+
+void DestroyVariants(ProgramVariants* variants)
+{
+	for (std::pair<const uint32_t, Program>& variant : variants->programs)
+		DestroyProgram(&variant.second);
+	variants->programs.clear();
+}
+
+// Finishes the program first if its uniforms haven't been reflected yet
+static UniformSlot* FindSlot(Program* program, Uniform uniform)
+{
+	if (program->build.pending)
+		FinishProgram(program);
+	return &program->uniforms[uniform];
+}
+
+// Whether value differs from what the slot last uploaded. Remembers value if so
+static bool Changed(UniformSlot* slot, const void* value, size_t size)
+{
+	gUniformStats.sets++;
+	if (slot->location == -1)
+		return false;
+
+	if (slot->uploaded && memcmp(slot->value, value, size) == 0)
+	{
+		gUniformStats.skipped++;
+		return false;
+	}
+
+	memcpy(slot->value, value, size);
+	slot->uploaded = true;
+	gUniformStats.uploads++;
+	return true;
+}
+
+void SetUniform(Program* program, Uniform uniform, int value)
+{
+	UniformSlot* slot = FindSlot(program, uniform);
+	if (Changed(slot, &value, sizeof(value)))
+		glProgramUniform1i(program->id, slot->location, value);
+}
+
+void SetUniform(Program* program, Uniform uniform, float value)
+{
+	UniformSlot* slot = FindSlot(program, uniform);
+	if (Changed(slot, &value, sizeof(value)))
+		glProgramUniform1f(program->id, slot->location, value);
+}
+
+void SetUniform(Program* program, Uniform uniform, Vector3 value)
+{
+	UniformSlot* slot = FindSlot(program, uniform);
+	if (Changed(slot, &value, sizeof(value)))
+		glProgramUniform3fv(program->id, slot->location, 1, &value.x);
+}
+
+void SetUniform(Program* program, Uniform uniform, Vector4 value)
+{
+	UniformSlot* slot = FindSlot(program, uniform);
+	if (Changed(slot, &value, sizeof(value)))
+		glProgramUniform4fv(program->id, slot->location, 1, &value.x);
+}
+
+void SetUniform(Program* program, Uniform uniform, Matrix value)
+{
+	UniformSlot* slot = FindSlot(program, uniform);
+	if (slot->type == GL_FLOAT_MAT3)
+	{
+		float9 m = ToFloat9(value);
+		if (Changed(slot, m.v, sizeof(m.v)))
+			glProgramUniformMatrix3fv(program->id, slot->location, 1, GL_FALSE, m.v);
+	}
+	else
+	{
+		float16 m = ToFloat16(value);
+		if (Changed(slot, m.v, sizeof(m.v)))
+			glProgramUniformMatrix4fv(program->id, slot->location, 1, GL_FALSE, m.v);
+	}
+}
+
+void ResetUniformStats()
+{
+	gUniformStats = UniformStats{};
+}
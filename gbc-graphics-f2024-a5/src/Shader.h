@@ -0,0 +1,152 @@
+#pragma once
+#include <glad/glad.h>
+#include "Math.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Every uniform our shaders declare. Programs find their locations once after linking so setting one is an array
+// index rather than a glGetUniformLocation string lookup. Add new uniforms here & to UNIFORM_NAMES in Shader.cpp
+enum Uniform
+{
+	U_MVP,
+	U_VIEW_PROJ,
+	U_WORLD,
+	U_NORMAL,
+	U_COLOR,
+	U_TEX,
+	U_TEX0,
+	U_TEX1,
+	U_T,
+	U_A,
+	U_CUBEMAP,
+	U_ATLAS_RECT,
+	U_ATLAS_LAYER,
+
+	UNIFORM_COUNT
+};
+
+// A uniform's location in one program & the last value uploaded to it
+struct UniformSlot
+{
+	GLint location = -1;	// -1 if the program doesn't use it
+	GLenum type = GL_NONE;	// GL_FLOAT_VEC3, GL_FLOAT_MAT4, GL_SAMPLER_2D etc
+	bool uploaded = false;
+	float value[16];
+};
+
+// What's left to do once the driver finishes a program submitted by CreatePrograms or a reload
+struct ProgramBuild
+{
+	bool pending = false;		// Compile & link status not checked yet
+	bool cached = false;		// Loaded from the binary cache rather than compiled
+	GLuint vs = GL_NONE;		// Stages being linked, detached once the link is checked
+	GLuint fs = GL_NONE;
+	GLuint next = GL_NONE;		// Replacement a hot reload is linking. Swapped in by UpdatePrograms
+	uint64_t cacheKey = 0;		// 0 if the driver can't save binaries
+	std::string vsPath, fsPath;
+	std::string defines;
+	std::chrono::high_resolution_clock::time_point submitted;	// When its CreatePrograms call began
+};
+
+struct Program
+{
+	GLuint id = GL_NONE;
+	UniformSlot uniforms[UNIFORM_COUNT];
+	ProgramBuild build;
+};
+
+// One program for CreatePrograms to build
+struct ProgramDesc
+{
+	Program* program;
+	const char* vsPath;
+	const char* fsPath;
+	const char* defines = nullptr;	// Lines inserted after #version in both shaders, ie "#define TEXTURED\n"
+};
+
+// Programs built from the same pair of shaders with different #defines, keyed by a bitmask of features.
+// Each variant is compiled the first time it's asked for
+struct ProgramVariants
+{
+	const char* vsPath;
+	const char* fsPath;
+	std::string (*defines)(uint32_t features);	// The #define lines a set of features needs
+	std::map<uint32_t, Program> programs;		// A map so Program pointers stay valid as variants are added
+};
+
+// Uniform calls since the last ResetUniformStats
+struct UniformStats
+{
+	int sets = 0;		// SetUniform calls. Each was a glGetUniformLocation before programs cached their locations
+	int lookups = 0;	// glGetUniformLocation calls (only when linking)
+	int uploads = 0;	// glProgramUniform calls
+	int skipped = 0;	// Sets that didn't change the program's value so weren't uploaded
+};
+
+extern UniformStats gUniformStats;
+
+// Programs created from paths since startup
+struct ProgramCacheStats
+{
+	int programs = 0;
+	int hits = 0;			// Loaded from their binary cache rather than compiled
+	double submitMs = 0.0;	// Time spent in CreatePrograms reading sources & submitting them to the driver
+	double readyMs = 0.0;	// From the start of the last CreatePrograms until its last program was finished
+};
+
+extern ProgramCacheStats gProgramCacheStats;
+
+// Compile a shader
+GLuint CreateShader(GLint type, const char* path);
+
+// Combine two compiled shaders into a program that can run on the GPU
+GLuint CreateProgram(GLuint vs, GLuint fs);
+
+// Links vs & fs, then looks up the location of each active uniform
+void CreateProgram(Program* program, GLuint vs, GLuint fs);
+
+// Compiles & links the shaders at vsPath & fsPath, or loads the binary saved by a previous run if neither source
+// nor the driver changed since. Prints whether the program was compiled or cached & how long it took
+void CreateProgram(Program* program, const char* vsPath, const char* fsPath);
+
+// Same as CreateProgram for every program at once, without waiting on the driver. Sources are read on a worker
+// thread & each program is submitted as soon as its files arrive. Compile & link status aren't checked until the
+// program is first used (UseProgram, SetUniform) or UpdatePrograms finds the driver done with it
+void CreatePrograms(const ProgramDesc* programs, int count);
+
+// Finishes the programs the driver is done compiling & swaps in finished reloads. Without
+// GL_KHR_parallel_shader_compile there's no way to ask, so every pending program is finished.
+// Call once per frame, before any program is used
+void UpdatePrograms();
+
+// Recompiles the shader files in directory as they're saved. Files are matched to programs by name. Each program
+// using a changed file is relinked in the background & swapped in by UpdatePrograms, so Program pointers stay valid.
+// A program that fails to compile keeps its previous version
+void WatchShaders(const char* directory);
+void UnwatchShaders();
+
+// Whether the program can be used without waiting for the driver
+bool IsProgramReady(const Program* program);
+
+// Binds the program, finishing it first if it's still pending
+void UseProgram(Program* program);
+void DestroyProgram(Program* program);
+
+// The variant for features. It's submitted if it doesn't exist yet, so using it straight away waits for the driver
+Program* GetVariant(ProgramVariants* variants, uint32_t features);
+
+// Submits the variants that will be needed in one batch so they compile alongside each other
+void PrepareVariants(ProgramVariants* variants, const uint32_t* features, int count);
+void DestroyVariants(ProgramVariants* variants);
+
+// Uploads value unless it's what the program already has. The program doesn't need to be bound.
+// Matrices are uploaded as mat3 or mat4 depending on the uniform's type
+void SetUniform(Program* program, Uniform uniform, int value);
+void SetUniform(Program* program, Uniform uniform, float value);
+void SetUniform(Program* program, Uniform uniform, Vector3 value);
+void SetUniform(Program* program, Uniform uniform, Vector4 value);
+void SetUniform(Program* program, Uniform uniform, Matrix value);
+
+void ResetUniformStats();
@@ -0,0 +1,182 @@
+#pragma once
+#include <cmath>
+
+//----------------------------------------------------------------------------------
+// 4-wide float vector abstraction used by Math.h's matrix & vector kernels.
+// The backend is picked at compile time: SSE on x86/x64, NEON on ARM64, plain floats otherwise.
+// Define SIMD_FORCE_SCALAR to build with the scalar backend (Math.h then uses its original scalar code).
+//----------------------------------------------------------------------------------
+#if defined(SIMD_FORCE_SCALAR)
+#define SIMD_SCALAR 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SIMD_SSE 1
+#include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define SIMD_SCALAR 1
+#endif
+
+#define SIMDAPI inline
+
+#if defined(SIMD_SSE)
+typedef __m128 SimdVec;
+#define SIMD_BACKEND "SSE"
+#elif defined(SIMD_NEON)
+typedef float32x4_t SimdVec;
+#define SIMD_BACKEND "NEON"
+#else
+typedef struct SimdVec {
+    float v[4];
+} SimdVec;
+#define SIMD_BACKEND "scalar"
+#endif
+
+// Unaligned load & store of 4 floats
+SIMDAPI SimdVec SimdLoad(const float* p)
+{
+#if defined(SIMD_SSE)
+    return _mm_loadu_ps(p);
+#elif defined(SIMD_NEON)
+    return vld1q_f32(p);
+#else
+    return { { p[0], p[1], p[2], p[3] } };
+#endif
+}
+
+SIMDAPI void SimdStore(float* p, SimdVec a)
+{
+#if defined(SIMD_SSE)
+    _mm_storeu_ps(p, a);
+#elif defined(SIMD_NEON)
+    vst1q_f32(p, a);
+#else
+    p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3];
+#endif
+}
+
+SIMDAPI SimdVec SimdSet(float x, float y, float z, float w)
+{
+#if defined(SIMD_SSE)
+    return _mm_setr_ps(x, y, z, w);
+#elif defined(SIMD_NEON)
+    float values[4] = { x, y, z, w };
+    return vld1q_f32(values);
+#else
+    return { { x, y, z, w } };
+#endif
+}
+
+SIMDAPI SimdVec SimdSplat(float value)
+{
+#if defined(SIMD_SSE)
+    return _mm_set1_ps(value);
+#elif defined(SIMD_NEON)
+    return vdupq_n_f32(value);
+#else
+    return { { value, value, value, value } };
+#endif
+}
+
+SIMDAPI float SimdGetX(SimdVec a)
+{
+#if defined(SIMD_SSE)
+    return _mm_cvtss_f32(a);
+#elif defined(SIMD_NEON)
+    return vgetq_lane_f32(a, 0);
+#else
+    return a.v[0];
+#endif
+}
+
+SIMDAPI SimdVec SimdAdd(SimdVec a, SimdVec b)
+{
+#if defined(SIMD_SSE)
+    return _mm_add_ps(a, b);
+#elif defined(SIMD_NEON)
+    return vaddq_f32(a, b);
+#else
+    return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } };
+#endif
+}
+
+SIMDAPI SimdVec SimdSub(SimdVec a, SimdVec b)
+{
+#if defined(SIMD_SSE)
+    return _mm_sub_ps(a, b);
+#elif defined(SIMD_NEON)
+    return vsubq_f32(a, b);
+#else
+    return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } };
+#endif
+}
+
+SIMDAPI SimdVec SimdMul(SimdVec a, SimdVec b)
+{
+#if defined(SIMD_SSE)
+    return _mm_mul_ps(a, b);
+#elif defined(SIMD_NEON)
+    return vmulq_f32(a, b);
+#else
+    return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } };
+#endif
+}
+
+SIMDAPI SimdVec SimdDiv(SimdVec a, SimdVec b)
+{
+#if defined(SIMD_SSE)
+    return _mm_div_ps(a, b);
+#elif defined(SIMD_NEON)
+    return vdivq_f32(a, b);
+#else
+    return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } };
+#endif
+}
+
+// Lanes x & y from a, lanes z & w from b (same as _mm_shuffle_ps). Swizzle a with SimdShuffle<...>(a, a)
+template<int X, int Y, int Z, int W>
+SIMDAPI SimdVec SimdShuffle(SimdVec a, SimdVec b)
+{
+#if defined(SIMD_SSE)
+    return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X));
+#elif defined(SIMD_NEON)
+    float32x4_t result = vdupq_n_f32(vgetq_lane_f32(a, X));
+    result = vsetq_lane_f32(vgetq_lane_f32(a, Y), result, 1);
+    result = vsetq_lane_f32(vgetq_lane_f32(b, Z), result, 2);
+    result = vsetq_lane_f32(vgetq_lane_f32(b, W), result, 3);
+    return result;
+#else
+    return { { a.v[X], a.v[Y], b.v[Z], b.v[W] } };
+#endif
+}
+
+// Every lane set to lane i of a
+template<int I>
+SIMDAPI SimdVec SimdLane(SimdVec a)
+{
+#if defined(SIMD_NEON)
+    return vdupq_laneq_f32(a, I);
+#else
+    return SimdShuffle<I, I, I, I>(a, a);
+#endif
+}
+
+// Sum of all lanes in every lane, added as (x + y) + (z + w)
+SIMDAPI SimdVec SimdSum(SimdVec a)
+{
+    SimdVec sum = SimdAdd(a, SimdShuffle<1, 0, 3, 2>(a, a));
+    return SimdAdd(sum, SimdShuffle<2, 3, 0, 1>(sum, sum));
+}
+
+SIMDAPI void SimdTranspose(SimdVec* r0, SimdVec* r1, SimdVec* r2, SimdVec* r3)
+{
+    SimdVec t0 = SimdShuffle<0, 1, 0, 1>(*r0, *r1);    // r0.x r0.y r1.x r1.y
+    SimdVec t1 = SimdShuffle<2, 3, 2, 3>(*r0, *r1);    // r0.z r0.w r1.z r1.w
+    SimdVec t2 = SimdShuffle<0, 1, 0, 1>(*r2, *r3);
+    SimdVec t3 = SimdShuffle<2, 3, 2, 3>(*r2, *r3);
+    *r0 = SimdShuffle<0, 2, 0, 2>(t0, t2);
+    *r1 = SimdShuffle<1, 3, 1, 3>(t0, t2);
+    *r2 = SimdShuffle<0, 2, 0, 2>(t1, t3);
+    *r3 = SimdShuffle<1, 3, 1, 3>(t1, t3);
+}
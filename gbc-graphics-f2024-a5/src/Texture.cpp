@@ -0,0 +1,869 @@
+#include "Texture.h"
+#include "TextureCompressor.h"
+#include "File.h"
+#include "GLState.h"
+#include "Simd.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+TextureStats gTextureStats;
+
+// Baked texture layout: TextureCacheHeader, then every level's blocks from the base down
+struct TextureCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;	// FNV-1a hash of the image the cache was baked from
+	uint32_t format;		// BlockFormat
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t flipped;
+};
+
+constexpr uint32_t TEXTURE_CACHE_MAGIC = 0x58455442;	// "BTEX"
+constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+
+enum JobState
+{
+	JOB_QUEUED,
+	JOB_DECODED,
+	JOB_FAILED
+};
+
+// A texture between CreateTexture & its last row being uploaded
+struct TextureJob
+{
+	Texture* texture = nullptr;
+	DecodedImage decoded;	// Set instead of texture for DecodeImage's jobs
+	std::string path;
+	TextureSettings settings;
+	std::atomic<int> state{ JOB_QUEUED };	// Set by the worker once pixels are ready
+	std::atomic<bool> cancelled{ false };	// The texture was destroyed, so there's no need to decode it
+
+	// Written by the worker before state, read by the main thread after
+	stbi_uc* pixels = nullptr;
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> chain;		// Levels below the base, if the mips are built on the CPU
+	std::vector<MipLevel> levels;
+	bool compressed = false;		// Uploaded from blocks rather than pixels & chain
+	bool cached = false;			// Blocks were read from the cache rather than baked
+	BlockFormat format = BLOCK_BC1;
+	std::vector<uint8_t> blocks;	// Every level, base first
+	std::vector<MipLevel> blockLevels;
+	double decodeMs = 0.0;
+	double mipMs = 0.0;
+	double compressMs = 0.0;
+	const char* failure = nullptr;	// stbi's reason is per thread, so it's kept for the main thread to print
+
+	GLuint id = GL_NONE;	// Storage being filled, swapped into the texture once complete
+	int level = 0;			// Being uploaded
+	int rowsUploaded = 0;	// Of that level
+
+	~TextureJob()
+	{
+		stbi_image_free(pixels);
+	}
+};
+
+// A band of rows copied to the current staging slot, uploaded once the slot is unmapped
+struct StagedRows
+{
+	std::shared_ptr<TextureJob> job;
+	int level;
+	int y;			// First row, in blocks if compressed
+	int width;		// Of the level
+	int height;
+	int rows;
+	size_t size;
+	size_t offset;
+	bool last;	// Completes the texture
+};
+
+// Pixel unpack buffers written in turn, one per UpdateTextures. The GPU reads a slot while the next ones are written
+constexpr int STAGING_SLOTS = 3;
+
+struct StagingSlot
+{
+	GLuint buffer = GL_NONE;
+	GLsync fence = nullptr;	// Signalled once the GPU has finished reading the slot
+};
+
+static std::mutex gQueueMutex;
+static std::condition_variable gQueueReady;
+static std::deque<std::shared_ptr<TextureJob>> gQueue;	// Waiting for a worker
+static std::vector<std::thread> gWorkers;
+static bool gStopping = false;
+
+static std::list<std::shared_ptr<TextureJob>> gJobs;	// Main thread only. Unfinished jobs in request order
+static StagingSlot gStaging[STAGING_SLOTS];
+static int gSlot = 0;
+static size_t gBudget = 0;
+static GLuint gPlaceholder = GL_NONE;
+static float gMaxAnisotropy = 1.0f;
+static bool gS3tc = false;	// Set before the workers start
+
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static std::string TextureCachePath(const std::string& path)
+{
+	return path + ".cache";
+}
+
+// Reads the job's blocks if its cache was baked from the same image with the same settings
+static bool LoadTextureCache(TextureJob* job)
+{
+	std::string cachePath = TextureCachePath(job->path);
+	struct stat imageStat, cacheStat;
+	if (stat(cachePath.c_str(), &cacheStat) != 0)
+		return false;
+
+	std::vector<uint8_t> bytes;
+	if (!ReadFile(cachePath.c_str(), &bytes) || bytes.size() < sizeof(TextureCacheHeader))
+		return false;
+
+	TextureCacheHeader header{};
+	memcpy(&header, bytes.data(), sizeof(header));
+	bool mipmapped = job->settings.mips != MIPS_NONE;
+	if (header.magic != TEXTURE_CACHE_MAGIC || header.version != TEXTURE_CACHE_VERSION || header.format > BLOCK_BC3 ||
+		header.flipped != (uint32_t)job->settings.flip || header.levelCount != (uint32_t)(mipmapped ? MipCount(header.width, header.height) : 1))
+		return false;
+
+	// Only re-hash the image if it was modified after the cache was written
+	bool stale = stat(job->path.c_str(), &imageStat) == 0 && imageStat.st_mtime > cacheStat.st_mtime;
+	if (stale && HashFile(job->path.c_str()) != header.sourceHash)
+		return false;
+
+	BlockFormat format = (BlockFormat)header.format;
+	std::vector<MipLevel> levels;
+	size_t size = 0;
+	int width = header.width, height = header.height;
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		levels.push_back({ width, height, size });
+		size += CompressedSize(format, width, height);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	if (bytes.size() != sizeof(header) + size)
+		return false;
+
+	job->compressed = true;
+	job->cached = true;
+	job->format = format;
+	job->width = header.width;
+	job->height = header.height;
+	job->blocks.assign(bytes.begin() + sizeof(header), bytes.end());
+	job->blockLevels = levels;
+	return true;
+}
+
+// Compresses every level of the decoded image & saves them as its cache. The pixels are freed once compressed
+static void BakeTexture(TextureJob* job)
+{
+	bool opaque = true;
+	for (int i = 0; i < job->width * job->height; i++)
+		opaque &= job->pixels[i * 4 + 3] == 255;
+	job->format = opaque ? BLOCK_BC1 : BLOCK_BC3;
+
+	job->blockLevels.push_back({ job->width, job->height, 0 });
+	for (const MipLevel& level : job->levels)
+		job->blockLevels.push_back({ level.width, level.height, 0 });
+
+	size_t size = 0;
+	for (MipLevel& level : job->blockLevels)
+	{
+		level.offset = size;
+		size += CompressedSize(job->format, level.width, level.height);
+	}
+
+	job->blocks.resize(size);
+	for (size_t i = 0; i < job->blockLevels.size(); i++)
+	{
+		const MipLevel& level = job->blockLevels[i];
+		const uint8_t* pixels = i == 0 ? job->pixels : job->chain.data() + job->levels[i - 1].offset;
+		CompressImage(pixels, level.width, level.height, job->format, job->blocks.data() + level.offset);
+	}
+	job->compressed = true;
+
+	TextureCacheHeader header{};
+	header.magic = TEXTURE_CACHE_MAGIC;
+	header.version = TEXTURE_CACHE_VERSION;
+	header.sourceHash = HashFile(job->path.c_str());
+	header.format = job->format;
+	header.width = job->width;
+	header.height = job->height;
+	header.levelCount = (uint32_t)job->blockLevels.size();
+	header.flipped = job->settings.flip;
+
+	std::string cachePath = TextureCachePath(job->path);
+	FILE* file = fopen(cachePath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		printf("**Warning: could not write texture cache %s**\n", cachePath.c_str());
+	}
+	else
+	{
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(job->blocks.data(), 1, job->blocks.size(), file);
+		fclose(file);
+	}
+
+	stbi_image_free(job->pixels);
+	job->pixels = nullptr;
+	job->chain.clear();
+	job->chain.shrink_to_fit();
+	job->levels.clear();
+}
+
+static void DecodeTextures()
+{
+	for (;;)
+	{
+		std::shared_ptr<TextureJob> job;
+		{
+			std::unique_lock<std::mutex> lock(gQueueMutex);
+			gQueueReady.wait(lock, [] { return gStopping || !gQueue.empty(); });
+			if (gStopping)
+				return;
+			job = gQueue.front();
+			gQueue.pop_front();
+		}
+
+		if (job->cancelled)
+			continue;
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		bool compress = job->settings.compress && gS3tc;
+		if (compress && LoadTextureCache(job.get()))
+		{
+			job->decodeMs = MillisecondsSince(start);
+			job->state = JOB_DECODED;
+			continue;
+		}
+
+		// Always 4 channels so every row is 4-byte aligned & every texture has the same format
+		int channels = 0;
+		stbi_set_flip_vertically_on_load_thread(job->settings.flip);
+		job->pixels = stbi_load(job->path.c_str(), &job->width, &job->height, &channels, STBI_rgb_alpha);
+		job->decodeMs = MillisecondsSince(start);
+		job->failure = job->pixels != nullptr ? nullptr : stbi_failure_reason();
+
+		bool mipmapped = job->settings.mips == MIPS_CPU || (compress && job->settings.mips != MIPS_NONE);
+		if (job->pixels != nullptr && mipmapped)
+		{
+			start = std::chrono::high_resolution_clock::now();
+			GenerateMipmaps(job->pixels, job->width, job->height, &job->chain, &job->levels);
+			job->mipMs = MillisecondsSince(start);
+		}
+
+		if (job->pixels != nullptr && compress)
+		{
+			start = std::chrono::high_resolution_clock::now();
+			BakeTexture(job.get());
+			job->compressMs = MillisecondsSince(start);
+		}
+		job->state = job->pixels != nullptr || job->compressed ? JOB_DECODED : JOB_FAILED;
+	}
+}
+
+void CreateTextureLoader(int threads, size_t budgetBytes)
+{
+	assert(gWorkers.empty());
+	if (threads <= 0)
+		threads = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+
+	gBudget = budgetBytes;
+	glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &gMaxAnisotropy);
+
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++)
+		gS3tc |= strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_EXT_texture_compression_s3tc") == 0;
+	for (StagingSlot& slot : gStaging)
+	{
+		glCreateBuffers(1, &slot.buffer);
+		glNamedBufferData(slot.buffer, gBudget, nullptr, GL_STREAM_DRAW);
+	}
+
+	// Mid grey, so untextured frames don't flash
+	const stbi_uc grey[4] = { 128, 128, 128, 255 };
+	glCreateTextures(GL_TEXTURE_2D, 1, &gPlaceholder);
+	glTextureStorage2D(gPlaceholder, 1, GL_RGBA8, 1, 1);
+	glTextureSubImage2D(gPlaceholder, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+
+	gStopping = false;
+	for (int i = 0; i < threads; i++)
+		gWorkers.emplace_back(DecodeTextures);
+}
+
+void DestroyTextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(gQueueMutex);
+		gStopping = true;
+		gQueue.clear();
+	}
+	gQueueReady.notify_all();
+	for (std::thread& worker : gWorkers)
+		worker.join();
+	gWorkers.clear();
+
+	for (const std::shared_ptr<TextureJob>& job : gJobs)
+		glDeleteTextures(1, &job->id);
+	gJobs.clear();
+
+	for (StagingSlot& slot : gStaging)
+	{
+		glDeleteSync(slot.fence);
+		glDeleteBuffers(1, &slot.buffer);
+		slot = StagingSlot{};
+	}
+
+	ForgetTexture(gPlaceholder);
+	glDeleteTextures(1, &gPlaceholder);
+	gPlaceholder = GL_NONE;
+}
+
+static void QueueJob(const std::shared_ptr<TextureJob>& job)
+{
+	gJobs.push_back(job);
+	{
+		std::lock_guard<std::mutex> lock(gQueueMutex);
+		gQueue.push_back(job);
+	}
+	gQueueReady.notify_one();
+	gTextureStats.requested++;
+}
+
+// Queues a job that swaps the texture's id once it's decoded & uploaded
+static void QueueTexture(Texture* texture)
+{
+	texture->requested = std::chrono::high_resolution_clock::now();
+	texture->failed = false;
+	std::shared_ptr<TextureJob> job = std::make_shared<TextureJob>();
+	job->texture = texture;
+	job->path = texture->path;
+	job->settings = texture->settings;
+	QueueJob(job);
+}
+
+void CreateTexture(Texture* texture, const char* path, TextureSettings settings)
+{
+	assert(gPlaceholder != GL_NONE && "CreateTextureLoader must be called first");
+	texture->id = gPlaceholder;
+	texture->width = texture->height = 0;
+	texture->loaded = false;
+	texture->format = GL_NONE;
+	texture->levels = texture->dropped = 0;
+	texture->path = path;
+	texture->settings = settings;
+	QueueTexture(texture);
+}
+
+void DecodeImage(const char* path, bool flip, DecodedImage done)
+{
+	assert(gPlaceholder != GL_NONE && "CreateTextureLoader must be called first");
+
+	// Just the pixels: no mips, compression or cache
+	std::shared_ptr<TextureJob> job = std::make_shared<TextureJob>();
+	job->decoded = done;
+	job->path = path;
+	job->settings.mips = MIPS_NONE;
+	job->settings.flip = flip;
+	job->settings.compress = false;
+	QueueJob(job);
+}
+
+void ReloadTexture(Texture* texture)
+{
+	for (const std::shared_ptr<TextureJob>& job : gJobs)
+	{
+		if (job->texture == texture)
+			return;
+	}
+	QueueTexture(texture);
+}
+
+void DestroyTexture(Texture* texture)
+{
+	// A job still decoding is left to its worker, which drops it when done
+	for (auto it = gJobs.begin(); it != gJobs.end(); ++it)
+	{
+		if ((*it)->texture == texture)
+		{
+			(*it)->cancelled = true;
+			(*it)->texture = nullptr;
+			ForgetTexture((*it)->id);
+			glDeleteTextures(1, &(*it)->id);
+			gJobs.erase(it);
+			break;
+		}
+	}
+
+	if (texture->id != gPlaceholder)
+	{
+		ForgetTexture(texture->id);
+		glDeleteTextures(1, &texture->id);
+	}
+	texture->id = GL_NONE;
+	texture->loaded = false;
+	texture->levels = texture->dropped = 0;
+}
+
+// Size of one level in the texture's format
+static size_t LevelBytes(GLenum format, int width, int height)
+{
+	if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+		return CompressedSize(BLOCK_BC1, width, height);
+	if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+		return CompressedSize(BLOCK_BC3, width, height);
+	return (size_t)width * height * 4;
+}
+
+size_t TextureBytes(const Texture& texture)
+{
+	if (!texture.loaded)
+		return 0;
+
+	size_t bytes = 0;
+	int width = std::max(texture.width >> texture.dropped, 1);
+	int height = std::max(texture.height >> texture.dropped, 1);
+	for (int level = 0; level < texture.levels; level++)
+	{
+		bytes += LevelBytes(texture.format, width, height);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	return bytes;
+}
+
+bool DropTopMip(Texture* texture)
+{
+	if (!texture->loaded || texture->levels <= 1)
+		return false;
+
+	// Same sampling as CreateStorage gave the original
+	const TextureSettings& settings = texture->settings;
+	int width = std::max(texture->width >> (texture->dropped + 1), 1);
+	int height = std::max(texture->height >> (texture->dropped + 1), 1);
+	GLuint id = GL_NONE;
+	glCreateTextures(GL_TEXTURE_2D, 1, &id);
+	glTextureStorage2D(id, texture->levels - 1, texture->format, width, height);
+	glTextureParameteri(id, GL_TEXTURE_WRAP_S, settings.wrap);
+	glTextureParameteri(id, GL_TEXTURE_WRAP_T, settings.wrap);
+	glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (settings.anisotropy > 1.0f)
+		glTextureParameterf(id, GL_TEXTURE_MAX_ANISOTROPY, std::min(settings.anisotropy, gMaxAnisotropy));
+
+	// Copied on the GPU, so nothing is read back or decoded again
+	for (int level = 0; level < texture->levels - 1; level++)
+	{
+		glCopyImageSubData(texture->id, GL_TEXTURE_2D, level + 1, 0, 0, 0, id, GL_TEXTURE_2D, level, 0, 0, 0, width, height, 1);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	ForgetTexture(texture->id);
+	glDeleteTextures(1, &texture->id);
+	texture->id = id;
+	texture->levels--;
+	texture->dropped++;
+	return true;
+}
+
+static GLenum InternalFormat(const TextureJob& job)
+{
+	if (!job.compressed)
+		return GL_RGBA8;
+	return job.format == BLOCK_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+// Creates the job's storage the first time it's uploaded to
+static void CreateStorage(TextureJob* job)
+{
+	const TextureSettings& settings = job->settings;
+	bool mipmapped = settings.mips != MIPS_NONE;
+	glCreateTextures(GL_TEXTURE_2D, 1, &job->id);
+	glTextureStorage2D(job->id, mipmapped ? MipCount(job->width, job->height) : 1, InternalFormat(*job), job->width, job->height);
+	glTextureParameteri(job->id, GL_TEXTURE_WRAP_S, settings.wrap);
+	glTextureParameteri(job->id, GL_TEXTURE_WRAP_T, settings.wrap);
+	glTextureParameteri(job->id, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(job->id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (mipmapped && settings.anisotropy > 1.0f)
+		glTextureParameterf(job->id, GL_TEXTURE_MAX_ANISOTROPY, std::min(settings.anisotropy, gMaxAnisotropy));
+}
+
+// Levels uploaded from the CPU: every level for MIPS_CPU & compressed textures, otherwise only the base
+static int UploadLevels(const TextureJob& job)
+{
+	return job.compressed ? (int)job.blockLevels.size() : 1 + (int)job.levels.size();
+}
+
+static void LevelSize(const TextureJob& job, int level, int* width, int* height)
+{
+	if (job.compressed)
+	{
+		*width = job.blockLevels[level].width;
+		*height = job.blockLevels[level].height;
+		return;
+	}
+	*width = level == 0 ? job.width : job.levels[level - 1].width;
+	*height = level == 0 ? job.height : job.levels[level - 1].height;
+}
+
+static const uint8_t* LevelPixels(const TextureJob& job, int level)
+{
+	if (job.compressed)
+		return job.blocks.data() + job.blockLevels[level].offset;
+	return level == 0 ? job.pixels : job.chain.data() + job.levels[level - 1].offset;
+}
+
+// Uploads are made of rows of pixels, or rows of blocks if compressed
+static int LevelRows(const TextureJob& job, int height)
+{
+	return job.compressed ? (height + 3) / 4 : height;
+}
+
+static size_t RowBytes(const TextureJob& job, int width)
+{
+	return job.compressed ? CompressedSize(job.format, width, 4) : width * 4;
+}
+
+static void FinishTexture(TextureJob* job)
+{
+	// The base level's upload is queued ahead of this, so the GPU builds the rest from it
+	if (job->settings.mips == MIPS_GPU && !job->compressed)
+		glGenerateTextureMipmap(job->id);
+
+	// Reloads replace the smaller version they were drawn with meanwhile
+	Texture* texture = job->texture;
+	if (texture->id != gPlaceholder)
+	{
+		ForgetTexture(texture->id);
+		glDeleteTextures(1, &texture->id);
+	}
+	texture->id = job->id;
+	texture->width = job->width;
+	texture->height = job->height;
+	texture->loaded = true;
+	texture->format = InternalFormat(*job);
+	texture->levels = job->settings.mips != MIPS_NONE ? MipCount(job->width, job->height) : 1;
+	texture->dropped = 0;
+	job->id = GL_NONE;
+	gTextureStats.loaded++;
+	if (job->cached)
+	{
+		gTextureStats.cached++;
+		printf("Texture %s: %ix%i %s read from cache in %.2f ms, ready %.2f ms after request\n", job->path.c_str(), job->width,
+			job->height, job->format == BLOCK_BC1 ? "BC1" : "BC3", job->decodeMs, MillisecondsSince(texture->requested));
+	}
+	else
+	{
+		printf("Texture %s: %ix%i decoded in %.2f ms (+%.2f ms of mips, +%.2f ms compressing), ready %.2f ms after request\n",
+			job->path.c_str(), job->width, job->height, job->decodeMs, job->mipMs, job->compressMs, MillisecondsSince(texture->requested));
+	}
+}
+
+void UpdateTextures()
+{
+	gTextureStats.uploadedBytes = 0;
+	gTextureStats.decoding = 0;
+	gTextureStats.uploading = 0;
+
+	// Never wait on the GPU. If it's still reading the slot, try again next frame
+	StagingSlot& slot = gStaging[gSlot];
+	bool slotFree = true;
+	if (slot.fence != nullptr)
+	{
+		if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			slotFree = false;
+			gTextureStats.stalls++;
+		}
+		else
+		{
+			glDeleteSync(slot.fence);
+			slot.fence = nullptr;
+		}
+	}
+
+	// Earlier requests go first, but one still decoding doesn't hold up later ones that are ready
+	static std::vector<StagedRows> staged;
+	staged.clear();
+	uint8_t* mapped = nullptr;
+	size_t used = 0;
+	for (auto it = gJobs.begin(); it != gJobs.end();)
+	{
+		const std::shared_ptr<TextureJob>& job = *it;
+		int state = job->state;
+		if (state == JOB_QUEUED)
+		{
+			gTextureStats.decoding++;
+			++it;
+			continue;
+		}
+
+		// Decoded images go to their callback rather than the GPU
+		if (job->decoded)
+		{
+			if (state == JOB_FAILED)
+			{
+				printf("Image %s: failed to decode (%s)\n", job->path.c_str(), job->failure);
+				gTextureStats.failed++;
+			}
+			else
+			{
+				printf("Image %s: %ix%i decoded in %.2f ms\n", job->path.c_str(), job->width, job->height, job->decodeMs);
+				gTextureStats.loaded++;
+			}
+			job->decoded(job->pixels, job->width, job->height);
+			it = gJobs.erase(it);
+			continue;
+		}
+
+		if (state == JOB_FAILED)
+		{
+			printf("Texture %s: failed to decode (%s), keeping the %s\n", job->path.c_str(), job->failure,
+				job->texture->loaded ? "smaller version" : "placeholder");
+			gTextureStats.failed++;
+			job->texture->failed = true;
+			it = gJobs.erase(it);
+			continue;
+		}
+
+		// The base level has the widest rows
+		size_t rowBytes = RowBytes(*job, job->width);
+		if (rowBytes > gBudget)
+		{
+			printf("Texture %s: a %zu byte row doesn't fit the %zu byte upload budget, keeping the %s\n",
+				job->path.c_str(), rowBytes, gBudget, job->texture->loaded ? "smaller version" : "placeholder");
+			gTextureStats.failed++;
+			job->texture->failed = true;
+			it = gJobs.erase(it);
+			continue;
+		}
+
+		// Bands of rows, level after level, until the budget runs out
+		while (slotFree && job->level < UploadLevels(*job))
+		{
+			int width, height;
+			LevelSize(*job, job->level, &width, &height);
+			rowBytes = RowBytes(*job, width);
+			int levelRows = LevelRows(*job, height);
+			int rows = std::min(levelRows - job->rowsUploaded, (int)((gBudget - used) / rowBytes));
+			if (rows == 0)
+				break;
+
+			if (job->id == GL_NONE)
+				CreateStorage(job.get());
+			if (mapped == nullptr)
+				mapped = (uint8_t*)glMapNamedBufferRange(slot.buffer, 0, gBudget, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+			memcpy(mapped + used, LevelPixels(*job, job->level) + job->rowsUploaded * rowBytes, rows * rowBytes);
+			staged.push_back({ job, job->level, job->rowsUploaded, width, height, rows, rows * rowBytes, used, false });
+			used += rows * rowBytes;
+			job->rowsUploaded += rows;
+			if (job->rowsUploaded == levelRows)
+			{
+				job->level++;
+				job->rowsUploaded = 0;
+			}
+		}
+
+		if (job->level < UploadLevels(*job))
+		{
+			gTextureStats.uploading++;
+			++it;
+		}
+		else
+		{
+			staged.back().last = true;
+			it = gJobs.erase(it);
+		}
+	}
+
+	if (mapped == nullptr)
+		return;
+
+	glUnmapNamedBuffer(slot.buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+	for (const StagedRows& rows : staged)
+	{
+		TextureJob* job = rows.job.get();
+		if (job->compressed)
+		{
+			// Block rows cover 4 pixel rows, except at the bottom of levels whose height isn't a multiple of 4
+			int y = rows.y * 4;
+			int height = std::min(rows.rows * 4, rows.height - y);
+			glCompressedTextureSubImage2D(job->id, rows.level, 0, y, rows.width, height, InternalFormat(*job), (GLsizei)rows.size, (void*)rows.offset);
+		}
+		else
+		{
+			glTextureSubImage2D(job->id, rows.level, 0, rows.y, rows.width, rows.rows, GL_RGBA, GL_UNSIGNED_BYTE, (void*)rows.offset);
+		}
+
+		// The upload is queued, so the texture can be drawn with from here on
+		if (rows.last)
+			FinishTexture(job);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gSlot = (gSlot + 1) % STAGING_SLOTS;
+	gTextureStats.uploadedBytes = used;
+	staged.clear();
+}
+
+int MipCount(int width, int height)
+{
+	int count = 1;
+	for (int size = std::max(width, height); size > 1; size /= 2)
+		count++;
+	return count;
+}
+
+// sRGB transfer functions
+static double SrgbToLinear(double c)
+{
+	return c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+}
+
+static double LinearToSrgb(double l)
+{
+	return l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+}
+
+// Steps of the linear to sRGB table. Fine enough that every encoded byte is within 1 of exact, even near black
+constexpr int LINEAR_STEPS = 16384;
+
+void GenerateMipmaps(const uint8_t* pixels, int width, int height, std::vector<uint8_t>* chain, std::vector<MipLevel>* levels)
+{
+	// Built on first use. Function statics are initialized once even with several workers calling
+	static const std::vector<float> toLinear = []
+	{
+		std::vector<float> table(256);
+		for (int i = 0; i < 256; i++)
+			table[i] = SrgbToLinear(i / 255.0);
+		return table;
+	}();
+	static const std::vector<uint8_t> toSrgb = []
+	{
+		std::vector<uint8_t> table(LINEAR_STEPS + 1);
+		for (int i = 0; i <= LINEAR_STEPS; i++)
+			table[i] = (uint8_t)(LinearToSrgb(i / (double)LINEAR_STEPS) * 255.0 + 0.5);
+		return table;
+	}();
+
+	chain->clear();
+	levels->clear();
+
+	// Each level is averaged from the last in linear floats, so rounding doesn't build up down the chain
+	std::vector<float> source(width * height * 4), target;
+	for (int i = 0; i < width * height; i++)
+	{
+		source[i * 4 + 0] = toLinear[pixels[i * 4 + 0]];
+		source[i * 4 + 1] = toLinear[pixels[i * 4 + 1]];
+		source[i * 4 + 2] = toLinear[pixels[i * 4 + 2]];
+		source[i * 4 + 3] = pixels[i * 4 + 3] / 255.0f;
+	}
+
+	const SimdVec quarter = SimdSplat(0.25f);
+	while (width > 1 || height > 1)
+	{
+		int w = std::max(width / 2, 1);
+		int h = std::max(height / 2, 1);
+		target.resize(w * h * 4);
+		for (int y = 0; y < h; y++)
+		{
+			const float* row0 = &source[std::min(y * 2, height - 1) * width * 4];
+			const float* row1 = &source[std::min(y * 2 + 1, height - 1) * width * 4];
+			for (int x = 0; x < w; x++)
+			{
+				int x0 = std::min(x * 2, width - 1) * 4;
+				int x1 = std::min(x * 2 + 1, width - 1) * 4;
+				SimdVec sum = SimdAdd(SimdAdd(SimdLoad(row0 + x0), SimdLoad(row0 + x1)), SimdAdd(SimdLoad(row1 + x0), SimdLoad(row1 + x1)));
+				SimdStore(&target[(y * w + x) * 4], SimdMul(sum, quarter));
+			}
+		}
+
+		MipLevel level = { w, h, chain->size() };
+		chain->resize(chain->size() + w * h * 4);
+		uint8_t* bytes = chain->data() + level.offset;
+		for (int i = 0; i < w * h * 4; i += 4)
+		{
+			bytes[i + 0] = toSrgb[(int)(target[i + 0] * LINEAR_STEPS + 0.5f)];
+			bytes[i + 1] = toSrgb[(int)(target[i + 1] * LINEAR_STEPS + 0.5f)];
+			bytes[i + 2] = toSrgb[(int)(target[i + 2] * LINEAR_STEPS + 0.5f)];
+			bytes[i + 3] = (uint8_t)(target[i + 3] * 255.0f + 0.5f);
+		}
+		levels->push_back(level);
+
+		source.swap(target);
+		width = w;
+		height = h;
+	}
+}
+
+void GenerateMipmapsScalar(const uint8_t* pixels, int width, int height, std::vector<uint8_t>* chain, std::vector<MipLevel>* levels)
+{
+	chain->clear();
+	levels->clear();
+
+	std::vector<double> source(width * height * 4), target;
+	for (int i = 0; i < width * height * 4; i++)
+		source[i] = (i % 4) == 3 ? pixels[i] / 255.0 : SrgbToLinear(pixels[i] / 255.0);
+
+	while (width > 1 || height > 1)
+	{
+		int w = std::max(width / 2, 1);
+		int h = std::max(height / 2, 1);
+		target.resize(w * h * 4);
+		for (int y = 0; y < h; y++)
+		{
+			int y0 = std::min(y * 2, height - 1);
+			int y1 = std::min(y * 2 + 1, height - 1);
+			for (int x = 0; x < w; x++)
+			{
+				int x0 = std::min(x * 2, width - 1);
+				int x1 = std::min(x * 2 + 1, width - 1);
+				for (int c = 0; c < 4; c++)
+				{
+					double sum = source[(y0 * width + x0) * 4 + c] + source[(y0 * width + x1) * 4 + c] +
+						source[(y1 * width + x0) * 4 + c] + source[(y1 * width + x1) * 4 + c];
+					target[(y * w + x) * 4 + c] = sum * 0.25;
+				}
+			}
+		}
+
+		MipLevel level = { w, h, chain->size() };
+		chain->resize(chain->size() + w * h * 4);
+		uint8_t* bytes = chain->data() + level.offset;
+		for (int i = 0; i < w * h * 4; i++)
+			bytes[i] = (uint8_t)(((i % 4) == 3 ? target[i] : LinearToSrgb(target[i])) * 255.0 + 0.5);
+		levels->push_back(level);
+
+		source.swap(target);
+		width = w;
+		height = h;
+	}
+}
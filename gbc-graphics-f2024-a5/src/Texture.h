@@ -0,0 +1,116 @@
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// GL_EXT_texture_compression_s3tc isn't core, so glad doesn't define it
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+
+// How a texture's mip chain is built
+enum MipGeneration
+{
+	MIPS_NONE,	// Base level only, sampled bilinearly
+	MIPS_GPU,	// glGenerateMipmap once the base level is uploaded. Averages in gamma space, so mips darken
+	MIPS_CPU	// GenerateMipmaps on the decoding thread, then uploaded with the base level
+};
+
+// Per-texture sampling, set before the texture is created
+struct TextureSettings
+{
+	MipGeneration mips = MIPS_CPU;
+	GLint wrap = GL_CLAMP_TO_EDGE;
+	float anisotropy = 8.0f;	// Clamped to what the driver supports. 1 turns it off. Needs mips to have an effect
+	bool flip = true;			// Bottom row first, which is what OpenGL & our obj tcoords expect
+	bool compress = true;		// BC1, or BC3 if any pixel isn't opaque. Mips are always built on the CPU when compressed
+};
+
+// One level of a mip chain built by GenerateMipmaps
+struct MipLevel
+{
+	int width;
+	int height;
+	size_t offset;	// Of its RGBA8 pixels in the chain
+};
+
+// A texture loaded in the background. id is a shared placeholder until the image has been decoded & uploaded,
+// so it can be drawn with straight away. Read id each time it's bound rather than keeping a copy
+struct Texture
+{
+	GLuint id = GL_NONE;
+	int width = 0;		// 0 until decoded
+	int height = 0;
+	bool loaded = false;	// id is the image rather than the placeholder
+	bool failed = false;	// The last load or reload was dropped, so id is still what it was before
+	GLenum format = GL_NONE;	// Internal format, once loaded
+	int levels = 0;			// Mip levels resident on the GPU
+	int dropped = 0;		// Largest levels released by DropTopMip. id's base level is (width, height) >> dropped
+	std::string path;
+	TextureSettings settings;
+	std::chrono::high_resolution_clock::time_point requested;	// When CreateTexture was called
+};
+
+// Texture loading since startup, & uploads since the last UpdateTextures
+struct TextureStats
+{
+	int requested = 0;
+	int decoding = 0;		// Queued or being decoded by a worker
+	int uploading = 0;		// Decoded, waiting for or partway through their upload
+	int loaded = 0;
+	int failed = 0;			// Couldn't be decoded. They keep the placeholder
+	int cached = 0;			// Loaded already compressed from their baked cache rather than decoded
+	size_t uploadedBytes = 0;	// Streamed to the GPU by the last UpdateTextures
+	int stalls = 0;			// UpdateTextures calls that skipped uploading because the GPU still owned the next staging slot
+};
+
+extern TextureStats gTextureStats;
+
+// Starts threads workers to decode images (0 uses every core but one). Staging buffers hold budgetBytes each,
+// which bounds how much UpdateTextures uploads per frame. A row of the widest image must fit in the budget
+void CreateTextureLoader(int threads = 0, size_t budgetBytes = 4 * 1024 * 1024);
+
+// Waits for the decodes in progress, then frees the workers, staging buffers & placeholder
+void DestroyTextureLoader();
+
+// Queues path to be loaded & returns immediately. Sampled trilinearly (bilinearly without mips) with the settings'
+// wrap & anisotropy. Compressed textures are baked to path.cache the first time they're decoded, so later runs read
+// the blocks & their mips straight from it. Without GL_EXT_texture_compression_s3tc they're loaded as RGBA8
+void CreateTexture(Texture* texture, const char* path, TextureSettings settings = {});
+void DestroyTexture(Texture* texture);
+
+// Called by UpdateTextures with a decoded image's RGBA8 pixels, or nullptr if it couldn't be decoded.
+// The pixels are freed once it returns
+typedef std::function<void(const uint8_t* pixels, int width, int height)> DecodedImage;
+
+// Decodes path on the workers like a texture but hands the pixels to done rather than uploading them, for images
+// copied into something else (like an atlas). Flipped if flip is set
+void DecodeImage(const char* path, bool flip, DecodedImage done);
+
+// Loads a texture that has dropped mips again in the background. Its id keeps the smaller version until the full one arrives
+void ReloadTexture(Texture* texture);
+
+// Replaces a loaded texture with a copy without its largest level, a quarter of its memory. False if it has one level left
+bool DropTopMip(Texture* texture);
+
+// GPU memory of the texture's resident levels. 0 until loaded
+size_t TextureBytes(const Texture& texture);
+
+// Uploads decoded images through the staging ring, up to the budget per call. Images bigger than the budget are
+// uploaded a band of rows at a time over several calls, level by level. Each texture's id is swapped once all of it has arrived.
+// Call once per frame
+void UpdateTextures();
+
+// Levels in a full chain down to 1x1
+int MipCount(int width, int height);
+
+// Every level below the base RGBA8 image, each half the size of the last (rounded down) & made by averaging 2x2
+// blocks. Colour is averaged in linear space (decoded from sRGB & encoded back), alpha as it is. Odd edges repeat
+// their last row or column. Runs 4 channels at once with Simd.h
+void GenerateMipmaps(const uint8_t* pixels, int width, int height, std::vector<uint8_t>* chain, std::vector<MipLevel>* levels);
+
+// Reference version of GenerateMipmaps, one channel at a time in doubles with exact sRGB conversions
+void GenerateMipmapsScalar(const uint8_t* pixels, int width, int height, std::vector<uint8_t>* chain, std::vector<MipLevel>* levels);
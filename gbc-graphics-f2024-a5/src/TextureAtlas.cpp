@@ -0,0 +1,213 @@
+#include "TextureAtlas.h"
+#include "Texture.h"
+#include "TextureCache.h"
+#include "GLState.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// imgui_draw.cpp has its own static copy, so this one doesn't clash with it
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+// Images are packed on a grid of cells as wide as the smallest mip's texels, so each image's mips line up with the
+// layer's & can be built from the image alone
+constexpr int ATLAS_CELL = 1 << (ATLAS_LEVELS - 1);
+
+// The skyline of each layer. The context points into nodes, so layers are kept behind pointers
+struct AtlasLayer
+{
+	stbrp_context context;
+	std::vector<stbrp_node> nodes;
+};
+
+struct AtlasPacker
+{
+	TextureAtlas* atlas = nullptr;
+	std::vector<std::unique_ptr<AtlasLayer>> layers;
+	float area = 0.0f;	// Texels covered by images
+};
+
+static int AtlasLevels(const TextureAtlas& atlas)
+{
+	return std::min(ATLAS_LEVELS, MipCount(atlas.size, atlas.size));
+}
+
+size_t TextureAtlasBytes(const TextureAtlas& atlas)
+{
+	size_t bytes = 0;
+	for (int level = 0; level < AtlasLevels(atlas); level++)
+	{
+		size_t size = atlas.size >> level;
+		bytes += size * size * 4 * atlas.layers;
+	}
+	return bytes;
+}
+
+// Replaces the atlas's texture with one a layer deeper, copying the existing layers across on the GPU
+static void AddLayer(TextureAtlas* atlas)
+{
+	int levels = AtlasLevels(*atlas);
+	GLuint id = GL_NONE;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &id);
+	glTextureStorage3D(id, levels, GL_RGBA8, atlas->size, atlas->size, atlas->layers + 1);
+	glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	if (atlas->id != GL_NONE)
+	{
+		for (int level = 0; level < levels; level++)
+		{
+			int size = atlas->size >> level;
+			glCopyImageSubData(atlas->id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, size, size, atlas->layers);
+		}
+		ForgetTexture(atlas->id);
+		glDeleteTextures(1, &atlas->id);
+	}
+	atlas->id = id;
+	atlas->layers++;
+	TrackTextureBytes(atlas, TextureAtlasBytes(*atlas));
+
+	int cells = atlas->size / ATLAS_CELL;
+	std::unique_ptr<AtlasLayer> layer(new AtlasLayer);
+	layer->nodes.resize(cells);
+	stbrp_init_target(&layer->context, cells, cells, layer->nodes.data(), cells);
+	atlas->packer->layers.push_back(std::move(layer));
+}
+
+void CreateTextureAtlas(TextureAtlas* atlas, int size)
+{
+	assert(size % ATLAS_CELL == 0);
+	atlas->id = GL_NONE;
+	atlas->size = size;
+	atlas->layers = 0;
+	atlas->images = atlas->pending = 0;
+	atlas->used = 0.0f;
+	atlas->packer = std::make_shared<AtlasPacker>();
+	atlas->packer->atlas = atlas;
+	AddLayer(atlas);
+
+	// The placeholder is packed like any other image, but isn't counted as one
+	const uint8_t grey[4] = { 128, 128, 128, 255 };
+	AddToAtlas(atlas, AtlasImage{ grey, 1, 1 }, &atlas->placeholder);
+	atlas->images = 0;
+	atlas->packer->area = 0.0f;
+	atlas->used = 0.0f;
+}
+
+bool AddToAtlas(TextureAtlas* atlas, const AtlasImage& image, AtlasRegion* region)
+{
+	// The image & its padding, rounded up to whole cells
+	int width = (image.width + ATLAS_PADDING * 2 + ATLAS_CELL - 1) / ATLAS_CELL * ATLAS_CELL;
+	int height = (image.height + ATLAS_PADDING * 2 + ATLAS_CELL - 1) / ATLAS_CELL * ATLAS_CELL;
+	if (width > atlas->size || height > atlas->size)
+	{
+		printf("**Warning: %ix%i image doesn't fit in a %ix%i atlas layer**\n", image.width, image.height, atlas->size, atlas->size);
+		return false;
+	}
+
+	// First layer with room, or a new one
+	stbrp_rect rect{};
+	rect.w = width / ATLAS_CELL;
+	rect.h = height / ATLAS_CELL;
+	int layer = 0;
+	std::vector<std::unique_ptr<AtlasLayer>>& layers = atlas->packer->layers;
+	while (layer < (int)layers.size() && !stbrp_pack_rects(&layers[layer]->context, &rect, 1))
+		layer++;
+	if (layer == (int)layers.size())
+	{
+		GLint maxLayers = 0;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+		if (atlas->layers == maxLayers)
+		{
+			printf("**Warning: %ix%i image doesn't fit in %i atlas layers**\n", image.width, image.height, maxLayers);
+			return false;
+		}
+		AddLayer(atlas);
+		stbrp_pack_rects(&layers[layer]->context, &rect, 1);
+		assert(rect.was_packed);
+	}
+
+	// The image surrounded by copies of its edge pixels, filling every cell it covers
+	std::vector<uint8_t> block(width * height * 4);
+	for (int y = 0; y < height; y++)
+	{
+		int sy = std::min(std::max(y - ATLAS_PADDING, 0), image.height - 1);
+		for (int x = 0; x < width; x++)
+		{
+			int sx = std::min(std::max(x - ATLAS_PADDING, 0), image.width - 1);
+			memcpy(&block[(y * width + x) * 4], image.pixels + (sy * image.width + sx) * 4, 4);
+		}
+	}
+
+	// Mips are built with the same downsampler as textures. Cells are aligned to the last level, so the block's own mips
+	// are exactly what downsampling the whole layer would give
+	int x = rect.x * ATLAS_CELL;
+	int y = rect.y * ATLAS_CELL;
+	glTextureSubImage3D(atlas->id, 0, x, y, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, block.data());
+	int levels = AtlasLevels(*atlas);
+	if (levels > 1)
+	{
+		std::vector<uint8_t> chain;
+		std::vector<MipLevel> mips;
+		GenerateMipmaps(block.data(), width, height, &chain, &mips);
+		for (int level = 1; level < levels; level++)
+		{
+			const MipLevel& mip = mips[level - 1];
+			glTextureSubImage3D(atlas->id, level, x >> level, y >> level, layer, mip.width, mip.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, chain.data() + mip.offset);
+		}
+	}
+
+	float size = (float)atlas->size;
+	region->layer = layer;
+	region->rect = { (x + ATLAS_PADDING) / size, (y + ATLAS_PADDING) / size, image.width / size, image.height / size };
+	atlas->images++;
+	atlas->packer->area += (float)image.width * image.height;
+	atlas->used = atlas->packer->area / (size * size * atlas->layers);
+	return true;
+}
+
+void AddToAtlas(TextureAtlas* atlas, const char* path, AtlasRegion* region, bool flip)
+{
+	*region = atlas->placeholder;
+	atlas->pending++;
+
+	// The atlas may be destroyed before the image arrives, in which case its packer is gone too
+	std::weak_ptr<AtlasPacker> packer = atlas->packer;
+	std::string name = path;
+	DecodeImage(path, flip, [packer, region, name](const uint8_t* pixels, int width, int height)
+	{
+		std::shared_ptr<AtlasPacker> alive = packer.lock();
+		if (alive == nullptr)
+			return;
+
+		TextureAtlas* atlas = alive->atlas;
+		atlas->pending--;
+		if (pixels == nullptr)
+		{
+			printf("**Warning: could not decode %s for the atlas, keeping the placeholder**\n", name.c_str());
+			return;
+		}
+		if (AddToAtlas(atlas, AtlasImage{ pixels, width, height }, region))
+			printf("Atlas: %s packed into layer %i, %i images in %i layer(s), %.0f%% covered\n", name.c_str(), region->layer,
+				atlas->images, atlas->layers, atlas->used * 100.0f);
+	});
+}
+
+void DestroyTextureAtlas(TextureAtlas* atlas)
+{
+	TrackTextureBytes(atlas, 0);
+	ForgetTexture(atlas->id);
+	glDeleteTextures(1, &atlas->id);
+	atlas->id = GL_NONE;
+	atlas->size = atlas->layers = 0;
+	atlas->images = atlas->pending = 0;
+	atlas->used = 0.0f;
+	atlas->packer.reset();
+}
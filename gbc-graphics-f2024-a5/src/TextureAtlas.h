@@ -0,0 +1,65 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "Math.h"
+
+// Pixels of each image's edge repeated around it, so filtering & the atlas's first mips never read a neighbour
+constexpr int ATLAS_PADDING = 4;
+
+// Levels in an atlas's mip chain. Below this the padding is under a texel & images would bleed into each other
+constexpr int ATLAS_LEVELS = 3;
+
+// An RGBA8 image to pack
+struct AtlasImage
+{
+	const uint8_t* pixels = nullptr;
+	int width = 0;
+	int height = 0;
+};
+
+// Where an image was packed. A tcoord t of the image is t * (rect.z, rect.w) + (rect.x, rect.y) in layer of the
+// atlas. The default is the whole of layer 0, so materials that don't use an atlas can keep it
+struct AtlasRegion
+{
+	int layer = 0;
+	Vector4 rect = { 0.0f, 0.0f, 1.0f, 1.0f };
+};
+
+// Free space of each layer, private to TextureAtlas.cpp
+struct AtlasPacker;
+
+// Small textures packed into the layers of one GL_TEXTURE_2D_ARRAY, so objects using any of them share a bind
+// & can be drawn together. Shaders compiled with ATLAS remap tcoords by their region (default.vert).
+// Images are added one at a time & a layer is added whenever one doesn't fit, which replaces id
+struct TextureAtlas
+{
+	GLuint id = GL_NONE;
+	int size = 0;		// Width & height of every layer
+	int layers = 0;
+	int images = 0;		// Packed so far
+	int pending = 0;	// Queued by path & still decoding
+	float used = 0.0f;	// Fraction of the layers' area covered by images rather than padding or free space
+	AtlasRegion placeholder;	// Mid grey, what images queued by path are drawn with until they arrive
+	std::shared_ptr<AtlasPacker> packer;
+};
+
+// An atlas of size x size layers with ATLAS_LEVELS mips, holding only the placeholder. Its layers count against the
+// texture cache's budget (TrackTextureBytes)
+void CreateTextureAtlas(TextureAtlas* atlas, int size = 1024);
+
+// Packs image into the first layer with room & uploads it & its mips. Writes its region, or returns false with a
+// warning & leaves region alone if it can't fit in a layer. Tcoords outside [0, 1] (repeating textures) would sample
+// neighbours, so those shouldn't be packed
+bool AddToAtlas(TextureAtlas* atlas, const AtlasImage& image, AtlasRegion* region);
+
+// Queues path to be decoded by the texture loader's workers & returns immediately. region is the placeholder until
+// a later UpdateTextures packs the image, so it must outlive the decode. Images that can't be decoded keep it
+void AddToAtlas(TextureAtlas* atlas, const char* path, AtlasRegion* region, bool flip = true);
+
+// Images still decoding are dropped when they arrive
+void DestroyTextureAtlas(TextureAtlas* atlas);
+
+// GPU memory of every layer & its mips
+size_t TextureAtlasBytes(const TextureAtlas& atlas);
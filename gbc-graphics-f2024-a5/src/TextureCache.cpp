@@ -0,0 +1,196 @@
+#include "TextureCache.h"
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+
+TextureCacheStats gTextureCacheStats;
+
+// Entries are heap allocated so Texture pointers stay valid for the loader & callers as the map grows
+static std::unordered_map<std::string, std::unique_ptr<CachedTexture>> gCache;
+static uint64_t gFrame = 1;
+static std::unordered_map<const void*, size_t> gTracked;
+
+// Mips are only dropped down to this size, so distant objects still look like themselves
+constexpr int MIN_RESIDENT_SIZE = 64;
+
+static CachedTexture* FindEntry(const Texture* texture)
+{
+	auto it = gCache.find(texture->path);
+	assert(it != gCache.end() && &it->second->texture == texture && "Texture wasn't acquired from the cache");
+	return it->second.get();
+}
+
+void CreateTextureCache(size_t budgetBytes)
+{
+	gTextureCacheStats = TextureCacheStats{};
+	gTextureCacheStats.budgetBytes = budgetBytes;
+	gFrame = 1;
+}
+
+void DestroyTextureCache()
+{
+	for (auto& entry : gCache)
+	{
+		if (entry.second->refs > 0)
+			printf("**Warning: texture %s destroyed with %i references**\n", entry.first.c_str(), entry.second->refs);
+		DestroyTexture(&entry.second->texture);
+	}
+	gCache.clear();
+}
+
+Texture* AcquireTexture(const char* path, TextureSettings settings)
+{
+	std::unique_ptr<CachedTexture>& entry = gCache[path];
+	if (entry == nullptr)
+	{
+		entry.reset(new CachedTexture);
+		CreateTexture(&entry->texture, path, settings);
+	}
+	entry->refs++;
+	return &entry->texture;
+}
+
+void ReleaseTexture(Texture* texture)
+{
+	CachedTexture* entry = FindEntry(texture);
+	assert(entry->refs > 0);
+	entry->refs--;
+}
+
+GLuint UseTexture(Texture* texture)
+{
+	FindEntry(texture)->lastUsed = gFrame;
+	return texture->id;
+}
+
+// What loading the texture's dropped mips again would add
+static size_t ReloadBytes(const Texture& texture)
+{
+	Texture full = texture;
+	full.levels += full.dropped;
+	full.dropped = 0;
+	return TextureBytes(full) - TextureBytes(texture);
+}
+
+// Whether memory can be reclaimed from the entry, & how much its next step frees
+static size_t Reclaimable(const CachedTexture& entry)
+{
+	const Texture& texture = entry.texture;
+	if (!texture.loaded || entry.reloading)
+		return 0;
+	if (entry.refs == 0)
+		return TextureBytes(texture);
+
+	int width = texture.width >> texture.dropped;
+	int height = texture.height >> texture.dropped;
+	if (texture.levels <= 1 || std::max(width, height) / 2 < MIN_RESIDENT_SIZE)
+		return 0;
+
+	// The largest level is what goes
+	Texture smaller = texture;
+	smaller.levels--;
+	smaller.dropped++;
+	return TextureBytes(texture) - TextureBytes(smaller);
+}
+
+void TrackTextureBytes(const void* owner, size_t bytes)
+{
+	if (bytes == 0)
+		gTracked.erase(owner);
+	else
+		gTracked[owner] = bytes;
+}
+
+void UpdateTextureCache()
+{
+	size_t tracked = 0;
+	for (auto& entry : gTracked)
+		tracked += entry.second;
+
+	// Textures in use at reduced size want their mips back, so they count against the budget too
+	size_t resident = tracked, wanted = 0;
+	for (auto& entry : gCache)
+	{
+		// A finished reload has put its mips back, & a failed one never will
+		CachedTexture& cached = *entry.second;
+		cached.reloading &= cached.texture.dropped > 0 && !cached.texture.failed;
+		resident += TextureBytes(cached.texture);
+		if (cached.lastUsed == gFrame && !cached.reloading && !cached.texture.failed)
+			wanted += ReloadBytes(cached.texture);
+	}
+
+	// Textures that weren't used this frame, least recently used first
+	std::vector<CachedTexture*> candidates;
+	for (auto& entry : gCache)
+	{
+		if (entry.second->lastUsed < gFrame)
+			candidates.push_back(entry.second.get());
+	}
+	std::sort(candidates.begin(), candidates.end(),
+		[](const CachedTexture* a, const CachedTexture* b) { return a->lastUsed < b->lastUsed; });
+
+	// Each pass takes one step from every candidate that has one, so textures in use shrink a level at a time together
+	bool progress = true;
+	while (resident + wanted > gTextureCacheStats.budgetBytes && progress)
+	{
+		progress = false;
+		for (CachedTexture* entry : candidates)
+		{
+			size_t bytes = Reclaimable(*entry);
+			if (bytes == 0 || resident + wanted <= gTextureCacheStats.budgetBytes)
+				continue;
+
+			if (entry->refs == 0)
+			{
+				std::string path = entry->texture.path;
+				printf("Texture %s: evicted, %zu KB freed\n", path.c_str(), bytes / 1024);
+				candidates.erase(std::find(candidates.begin(), candidates.end(), entry));
+				DestroyTexture(&entry->texture);
+				gCache.erase(path);
+				gTextureCacheStats.evicted++;
+				resident -= bytes;
+				progress = true;
+				break;
+			}
+
+			DropTopMip(&entry->texture);
+			gTextureCacheStats.dropped++;
+			resident -= bytes;
+			progress = true;
+		}
+	}
+
+	// Then reloaded if the full texture fits. Ones that failed keep their smaller version rather than retrying every frame
+	for (auto& entry : gCache)
+	{
+		CachedTexture& cached = *entry.second;
+		if (cached.lastUsed != gFrame || cached.texture.dropped == 0 || cached.reloading || cached.texture.failed)
+			continue;
+
+		size_t extra = ReloadBytes(cached.texture);
+		if (resident + extra > gTextureCacheStats.budgetBytes)
+			continue;
+
+		ReloadTexture(&cached.texture);
+		cached.reloading = true;
+		gTextureCacheStats.reloaded++;
+		resident += extra;
+	}
+
+	gTextureCacheStats.textures = (int)gCache.size();
+	gTextureCacheStats.residentBytes = resident;
+	gTextureCacheStats.trackedBytes = tracked;
+	gFrame++;
+}
+
+std::vector<const CachedTexture*> CachedTextures()
+{
+	std::vector<const CachedTexture*> textures;
+	for (auto& entry : gCache)
+		textures.push_back(entry.second.get());
+	std::sort(textures.begin(), textures.end(),
+		[](const CachedTexture* a, const CachedTexture* b) { return a->lastUsed < b->lastUsed; });
+	return textures;
+}
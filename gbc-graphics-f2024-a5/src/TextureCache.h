@@ -0,0 +1,54 @@
+#pragma once
+#include "Texture.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A texture shared by everything that acquired its path
+struct CachedTexture
+{
+	Texture texture;
+	int refs = 0;				// Released textures stay resident until the budget needs their memory
+	uint64_t lastUsed = 0;		// Frame UseTexture last returned it
+	bool reloading = false;		// Its dropped mips are being loaded again. Cleared when they arrive or the reload fails
+};
+
+// Residency after the last UpdateTextureCache
+struct TextureCacheStats
+{
+	int textures = 0;
+	size_t residentBytes = 0;	// Including trackedBytes
+	size_t trackedBytes = 0;	// Of textures the cache doesn't own, from TrackTextureBytes
+	size_t budgetBytes = 0;
+	int evicted = 0;		// Released textures deleted to fit the budget since startup
+	int dropped = 0;		// Top mips released from textures still in use since startup
+	int reloaded = 0;		// Textures loaded at full size again since startup
+};
+
+extern TextureCacheStats gTextureCacheStats;
+
+// Keeps the textures' GPU memory under budgetBytes. Call after CreateTextureLoader
+void CreateTextureCache(size_t budgetBytes = 256 * 1024 * 1024);
+
+// Deletes every cached texture, acquired or not
+void DestroyTextureCache();
+
+// The texture for path, created with settings if it isn't cached yet (the first settings win). Adds a reference
+Texture* AcquireTexture(const char* path, TextureSettings settings = {});
+void ReleaseTexture(Texture* texture);
+
+// id to bind this frame. Marks the texture as used, so it isn't the next to be evicted
+GLuint UseTexture(Texture* texture);
+
+// Call once per frame after its draws. While over budget, textures not used this frame are reclaimed least
+// recently used first: released ones are deleted & the rest drop their largest mips. Textures that have dropped mips
+// are reloaded at full size once they're used again & there's room. A reload that fails isn't retried
+void UpdateTextureCache();
+
+// Counts bytes of GPU memory the cache doesn't own (like an atlas) against its budget, so cached textures make room
+// for them. Replaces what owner counted before, & 0 stops counting it
+void TrackTextureBytes(const void* owner, size_t bytes);
+
+// Every cached texture, least recently used first
+std::vector<const CachedTexture*> CachedTextures();
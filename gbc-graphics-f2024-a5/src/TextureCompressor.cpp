@@ -0,0 +1,292 @@
+#include "TextureCompressor.h"
+#include "Simd.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// Power iterations to find a block's principal axis. Converges well within this for 16 points
+constexpr int PRINCIPAL_AXIS_ITERATIONS = 8;
+
+size_t BlockBytes(BlockFormat format)
+{
+	return format == BLOCK_BC1 ? 8 : 16;
+}
+
+size_t CompressedSize(BlockFormat format, int width, int height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+static uint16_t Pack565(float r, float g, float b)
+{
+	auto quantize = [](float value, int max)
+	{
+		return (uint16_t)std::min(std::max((int)(value * max / 255.0f + 0.5f), 0), max);
+	};
+	return quantize(r, 31) << 11 | quantize(g, 63) << 5 | quantize(b, 31);
+}
+
+static void Unpack565(uint16_t color, uint8_t* rgb)
+{
+	uint8_t r = color >> 11 & 31;
+	uint8_t g = color >> 5 & 63;
+	uint8_t b = color & 31;
+	rgb[0] = r << 3 | r >> 2;
+	rgb[1] = g << 2 | g >> 4;
+	rgb[2] = b << 3 | b >> 2;
+}
+
+// The 4-colour half of a BC1 block. Never uses BC1's 3-colour mode, so it's also valid as BC3's colour block
+static void EncodeColor(const uint8_t* pixels, uint8_t* block)
+{
+	float r[16], g[16], b[16];
+	for (int i = 0; i < 16; i++)
+	{
+		r[i] = pixels[i * 4 + 0];
+		g[i] = pixels[i * 4 + 1];
+		b[i] = pixels[i * 4 + 2];
+	}
+
+	SimdVec rs[4], gs[4], bs[4];
+	SimdVec sumR = SimdSplat(0.0f), sumG = SimdSplat(0.0f), sumB = SimdSplat(0.0f);
+	for (int i = 0; i < 4; i++)
+	{
+		rs[i] = SimdLoad(r + i * 4);
+		gs[i] = SimdLoad(g + i * 4);
+		bs[i] = SimdLoad(b + i * 4);
+		sumR = SimdAdd(sumR, rs[i]);
+		sumG = SimdAdd(sumG, gs[i]);
+		sumB = SimdAdd(sumB, bs[i]);
+	}
+	float meanR = SimdGetX(SimdSum(sumR)) / 16.0f;
+	float meanG = SimdGetX(SimdSum(sumG)) / 16.0f;
+	float meanB = SimdGetX(SimdSum(sumB)) / 16.0f;
+
+	// Covariance of the colours around their mean
+	SimdVec rr = SimdSplat(0.0f), rg = rr, rb = rr, gg = rr, gb = rr, bb = rr;
+	for (int i = 0; i < 4; i++)
+	{
+		rs[i] = SimdSub(rs[i], SimdSplat(meanR));
+		gs[i] = SimdSub(gs[i], SimdSplat(meanG));
+		bs[i] = SimdSub(bs[i], SimdSplat(meanB));
+		rr = SimdAdd(rr, SimdMul(rs[i], rs[i]));
+		rg = SimdAdd(rg, SimdMul(rs[i], gs[i]));
+		rb = SimdAdd(rb, SimdMul(rs[i], bs[i]));
+		gg = SimdAdd(gg, SimdMul(gs[i], gs[i]));
+		gb = SimdAdd(gb, SimdMul(gs[i], bs[i]));
+		bb = SimdAdd(bb, SimdMul(bs[i], bs[i]));
+	}
+	float crr = SimdGetX(SimdSum(rr)), crg = SimdGetX(SimdSum(rg)), crb = SimdGetX(SimdSum(rb));
+	float cgg = SimdGetX(SimdSum(gg)), cgb = SimdGetX(SimdSum(gb)), cbb = SimdGetX(SimdSum(bb));
+
+	float ax = 1.0f, ay = 1.0f, az = 1.0f;
+	for (int i = 0; i < PRINCIPAL_AXIS_ITERATIONS; i++)
+	{
+		float x = crr * ax + crg * ay + crb * az;
+		float y = crg * ax + cgg * ay + cgb * az;
+		float z = crb * ax + cgb * ay + cbb * az;
+		float length = std::max(std::max(fabsf(x), fabsf(y)), fabsf(z));
+		if (length == 0.0f)
+		{
+			// Every pixel is the same colour
+			ax = ay = az = 0.0f;
+			break;
+		}
+		ax = x / length;
+		ay = y / length;
+		az = z / length;
+	}
+
+	// Unit length, so projections onto the axis are distances along it
+	float length = sqrtf(ax * ax + ay * ay + az * az);
+	if (length > 0.0f)
+	{
+		ax /= length;
+		ay /= length;
+		az /= length;
+	}
+
+	// Extremes along the axis
+	float t[16];
+	for (int i = 0; i < 4; i++)
+		SimdStore(t + i * 4, SimdAdd(SimdAdd(SimdMul(rs[i], SimdSplat(ax)), SimdMul(gs[i], SimdSplat(ay))), SimdMul(bs[i], SimdSplat(az))));
+	float minT = *std::min_element(t, t + 16);
+	float maxT = *std::max_element(t, t + 16);
+
+	uint16_t c0 = Pack565(meanR + ax * maxT, meanG + ay * maxT, meanB + az * maxT);
+	uint16_t c1 = Pack565(meanR + ax * minT, meanG + ay * minT, meanB + az * minT);
+	if (c0 < c1)
+		std::swap(c0, c1);
+
+	uint32_t indices = 0;
+	if (c0 != c1)
+	{
+		// Each pixel's position between the endpoints the decoder will see, in thirds
+		uint8_t e0[3], e1[3];
+		Unpack565(c0, e0);
+		Unpack565(c1, e1);
+		float dr = e1[0] - e0[0], dg = e1[1] - e0[1], db = e1[2] - e0[2];
+		float scale = 3.0f / (dr * dr + dg * dg + db * db);
+		SimdVec sr = SimdSplat(dr * scale), sg = SimdSplat(dg * scale), sb = SimdSplat(db * scale);
+		for (int i = 0; i < 4; i++)
+		{
+			SimdVec pr = SimdSub(SimdLoad(r + i * 4), SimdSplat(e0[0]));
+			SimdVec pg = SimdSub(SimdLoad(g + i * 4), SimdSplat(e0[1]));
+			SimdVec pb = SimdSub(SimdLoad(b + i * 4), SimdSplat(e0[2]));
+			SimdStore(t + i * 4, SimdAdd(SimdAdd(SimdMul(pr, sr), SimdMul(pg, sg)), SimdMul(pb, sb)));
+		}
+
+		// Thirds from c0 to c1 are indices 0, 2, 3 & 1
+		const uint32_t order[4] = { 0, 2, 3, 1 };
+		for (int i = 0; i < 16; i++)
+		{
+			int step = std::min(std::max((int)(t[i] + 0.5f), 0), 3);
+			indices |= order[step] << (i * 2);
+		}
+	}
+
+	memcpy(block + 0, &c0, 2);
+	memcpy(block + 2, &c1, 2);
+	memcpy(block + 4, &indices, 4);
+}
+
+// BC3's alpha half. Always the 8-value mode (a0 > a1), so 0 & 255 are only exact at the extremes
+static void EncodeAlpha(const uint8_t* pixels, uint8_t* block)
+{
+	uint8_t a0 = 0, a1 = 255;
+	for (int i = 0; i < 16; i++)
+	{
+		a0 = std::max(a0, pixels[i * 4 + 3]);
+		a1 = std::min(a1, pixels[i * 4 + 3]);
+	}
+
+	uint64_t indices = 0;
+	if (a0 != a1)
+	{
+		// Sevenths from a0 to a1 are indices 0, 2, 3, 4, 5, 6, 7 & 1
+		float scale = 7.0f / (a0 - a1);
+		for (int i = 0; i < 16; i++)
+		{
+			int step = (int)((a0 - pixels[i * 4 + 3]) * scale + 0.5f);
+			uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+			indices |= index << (i * 3);
+		}
+	}
+
+	block[0] = a0;
+	block[1] = a1;
+	memcpy(block + 2, &indices, 6);
+}
+
+void EncodeBC1(const uint8_t* pixels, uint8_t* block)
+{
+	EncodeColor(pixels, block);
+}
+
+void EncodeBC3(const uint8_t* pixels, uint8_t* block)
+{
+	EncodeAlpha(pixels, block);
+	EncodeColor(pixels, block + 8);
+}
+
+// threeColor is BC1's mode for c0 <= c1, where index 3 is transparent black. BC3 never uses it
+static void DecodeColor(const uint8_t* block, uint8_t* pixels, bool threeColor)
+{
+	uint16_t c0, c1;
+	uint32_t indices;
+	memcpy(&c0, block + 0, 2);
+	memcpy(&c1, block + 2, 2);
+	memcpy(&indices, block + 4, 4);
+
+	uint8_t palette[4][4];
+	Unpack565(c0, palette[0]);
+	Unpack565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+	for (int c = 0; c < 3; c++)
+	{
+		if (threeColor && c0 <= c1)
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+		else
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+	if (threeColor && c0 <= c1)
+		palette[3][3] = 0;
+
+	for (int i = 0; i < 16; i++)
+		memcpy(pixels + i * 4, palette[indices >> (i * 2) & 3], 4);
+}
+
+void DecodeBC1(const uint8_t* block, uint8_t* pixels)
+{
+	DecodeColor(block, pixels, true);
+}
+
+void DecodeBC3(const uint8_t* block, uint8_t* pixels)
+{
+	DecodeColor(block + 8, pixels, false);
+
+	uint8_t a0 = block[0], a1 = block[1];
+	uint8_t palette[8] = { a0, a1 };
+	for (int i = 1; i < 7; i++)
+		palette[i + 1] = a0 > a1 ? ((7 - i) * a0 + i * a1) / 7 : i < 5 ? ((5 - i) * a0 + i * a1) / 5 : i == 5 ? 0 : 255;
+
+	uint64_t indices = 0;
+	memcpy(&indices, block + 2, 6);
+	for (int i = 0; i < 16; i++)
+		pixels[i * 4 + 3] = palette[indices >> (i * 3) & 7];
+}
+
+void CompressImage(const uint8_t* pixels, int width, int height, BlockFormat format, uint8_t* blocks)
+{
+	size_t blockBytes = BlockBytes(format);
+	uint8_t tile[16 * 4];
+	for (int by = 0; by < height; by += 4)
+	{
+		for (int bx = 0; bx < width; bx += 4)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					int sx = std::min(bx + x, width - 1);
+					int sy = std::min(by + y, height - 1);
+					memcpy(tile + (y * 4 + x) * 4, pixels + (sy * width + sx) * 4, 4);
+				}
+			}
+
+			if (format == BLOCK_BC1)
+				EncodeBC1(tile, blocks);
+			else
+				EncodeBC3(tile, blocks);
+			blocks += blockBytes;
+		}
+	}
+}
+
+void DecompressImage(const uint8_t* blocks, int width, int height, BlockFormat format, uint8_t* pixels)
+{
+	size_t blockBytes = BlockBytes(format);
+	uint8_t tile[16 * 4];
+	for (int by = 0; by < height; by += 4)
+	{
+		for (int bx = 0; bx < width; bx += 4)
+		{
+			if (format == BLOCK_BC1)
+				DecodeBC1(blocks, tile);
+			else
+				DecodeBC3(blocks, tile);
+			blocks += blockBytes;
+
+			for (int y = 0; y < 4 && by + y < height; y++)
+				for (int x = 0; x < 4 && bx + x < width; x++)
+					memcpy(pixels + ((by + y) * width + bx + x) * 4, tile + (y * 4 + x) * 4, 4);
+		}
+	}
+}
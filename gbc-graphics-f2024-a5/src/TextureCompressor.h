@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// S3TC block formats. Each block holds 4x4 pixels
+enum BlockFormat
+{
+	BLOCK_BC1,	// 8 bytes, RGB565 endpoints & 2-bit indices. For opaque images (4 bits per pixel)
+	BLOCK_BC3	// 16 bytes, a BC1 colour block after an 8-bit alpha block with 3-bit indices (8 bits per pixel)
+};
+
+size_t BlockBytes(BlockFormat format);
+
+// Bytes of a width x height image once compressed, including the padding of partial blocks at its edges
+size_t CompressedSize(BlockFormat format, int width, int height);
+
+// Encodes 16 RGBA8 pixels, row by row. Endpoints are the extremes of the block's colours along their principal axis
+// & each pixel takes the nearest point between them. Projections run 4 pixels at once with Simd.h
+void EncodeBC1(const uint8_t* pixels, uint8_t* block);
+void EncodeBC3(const uint8_t* pixels, uint8_t* block);
+
+// Inverse of the above, to measure what compression loses
+void DecodeBC1(const uint8_t* block, uint8_t* pixels);
+void DecodeBC3(const uint8_t* block, uint8_t* pixels);
+
+// Encodes an RGBA8 image block by block. Partial blocks at its edges repeat the last column or row
+void CompressImage(const uint8_t* pixels, int width, int height, BlockFormat format, uint8_t* blocks);
+
+// Decodes a compressed image back to width x height RGBA8
+void DecompressImage(const uint8_t* blocks, int width, int height, BlockFormat format, uint8_t* pixels);
@@ -1,11 +1,16 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "Mesh.h"
+#include "Shader.h"
+#include "Light.h"
+#include "RenderQueue.h"
+#include "GeometryPool.h"
+#include "GLState.h"
 #include "Math.h"
-#include <stb_image.h>
-
-// TODO -- Texture.h & Texture.cpp during lab, show result next lexture
-#define STB_IMAGE_IMPLEMENTATION
+#include "Benchmark.h"
+#include "Texture.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
 #include <stb_image.h>
 
 #include "imgui/imgui.h"
@@ -14,9 +19,8 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <array>
 
 constexpr int SCREEN_WIDTH = 1280;
@@ -27,9 +31,6 @@ void APIENTRY glDebugOutput(GLenum source, GLenum type, unsigned int id, GLenum
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void error_callback(int error, const char* description);
 
-GLuint CreateShader(GLint type, const char* path);
-GLuint CreateProgram(GLuint vs, GLuint fs);
-
 std::array<int, GLFW_KEY_LAST> gKeysCurr{}, gKeysPrev{};
 bool IsKeyDown(int key);
 bool IsKeyUp(int key);
@@ -51,8 +52,11 @@ struct Pixel
     stbi_uc a = 255;
 };
 
-int main(void)
+int main(int argc, char** argv)
 {
+    // --selftest runs every benchmark's checks once in a hidden window & exits with 1 if any failed
+    bool selfTest = argc > 1 && strcmp(argv[1], "--selftest") == 0;
+
     glfwSetErrorCallback(error_callback);
     assert(glfwInit() == GLFW_TRUE);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -62,6 +66,7 @@ int main(void)
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #endif
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, selfTest ? GLFW_FALSE : GLFW_TRUE);
 
     GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Graphics 1", NULL, NULL);
     glfwMakeContextCurrent(window);
@@ -74,47 +79,73 @@ int main(void)
     glDebugMessageCallback(glDebugOutput, nullptr);
 #endif
 
+    if (selfTest)
+    {
+        int failures = RunSelfTests();
+        glfwTerminate();
+        return failures == 0 ? 0 : 1;
+    }
+
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui::StyleColorsDark();
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 460");
 
-    // Vertex shaders:
-    GLuint vs = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/default.vert");
-    GLuint vsSkybox = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/skybox.vert");
-    GLuint vsPoints = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/points.vert");
-    GLuint vsLines = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/lines.vert");
-    GLuint vsVertexPositionColor = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/vertex_color.vert");
-    GLuint vsColorBufferColor = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/buffer_color.vert");
-
-    // Fragment shaders:
-    GLuint fsSkybox = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/skybox.frag");
-    GLuint fsLines = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/lines.frag");
-    GLuint fsUniformColor = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/uniform_color.frag");
-    GLuint fsVertexColor = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/vertex_color.frag");
-    GLuint fsTcoords = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/tcoord_color.frag");
-    GLuint fsNormals = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/normal_color.frag");
-    GLuint fsTexture = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/texture_color.frag");
-    GLuint fsTextureMix = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/texture_color_mix.frag");
-    GLuint fsPhongColor = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/phong_color.frag");
-    GLuint fsPhongGrey = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/phong_grey.frag");
-    GLuint fsPhong = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/phong.frag");
-
-    // Shader programs:
-    GLuint shaderUniformColor = CreateProgram(vs, fsUniformColor);
-    GLuint shaderVertexPositionColor = CreateProgram(vsVertexPositionColor, fsVertexColor);
-    GLuint shaderVertexBufferColor = CreateProgram(vsColorBufferColor, fsVertexColor);
-    GLuint shaderPoints = CreateProgram(vsPoints, fsVertexColor);
-    GLuint shaderLines = CreateProgram(vsLines, fsLines);
-    GLuint shaderTcoords = CreateProgram(vs, fsTcoords);
-    GLuint shaderNormals = CreateProgram(vs, fsNormals);
-    GLuint shaderTexture = CreateProgram(vs, fsTexture);
-    GLuint shaderTextureMix = CreateProgram(vs, fsTextureMix);
-    GLuint shaderSkybox = CreateProgram(vsSkybox, fsSkybox);
-    GLuint shaderPhongColor = CreateProgram(vs, fsPhongColor);
-    GLuint shaderPhongGrey = CreateProgram(vs, fsPhongGrey);
-    GLuint shaderPhong = CreateProgram(vs, fsPhong);
+    // Shader programs (compiled from source, or loaded from the binaries cached by a previous run):
+    const char* vs = "./assets/shaders/default.vert";
+    const char* vsSkybox = "./assets/shaders/skybox.vert";
+    const char* vsPoints = "./assets/shaders/points.vert";
+    const char* vsLines = "./assets/shaders/lines.vert";
+    const char* vsVertexPositionColor = "./assets/shaders/vertex_color.vert";
+    const char* vsColorBufferColor = "./assets/shaders/buffer_color.vert";
+
+    const char* fsSkybox = "./assets/shaders/skybox.frag";
+    const char* fsLines = "./assets/shaders/lines.frag";
+    const char* fsUniformColor = "./assets/shaders/uniform_color.frag";
+    const char* fsVertexColor = "./assets/shaders/vertex_color.frag";
+    const char* fsTcoords = "./assets/shaders/tcoord_color.frag";
+    const char* fsNormals = "./assets/shaders/normal_color.frag";
+    const char* fsTexture = "./assets/shaders/texture_color.frag";
+    const char* fsTextureMix = "./assets/shaders/texture_color_mix.frag";
+    const char* fsPhong = "./assets/shaders/phong.frag";
+
+    Program shaderUniformColor, shaderUniformColorInstanced, shaderVertexPositionColor, shaderVertexBufferColor, shaderPoints, shaderLines,
+        shaderTcoords, shaderNormals, shaderTexture, shaderTexturePooledAtlas, shaderTextureMix, shaderSkybox;
+    ProgramDesc programs[] =
+    {
+        { &shaderUniformColor, vs, fsUniformColor },
+        { &shaderUniformColorInstanced, vs, fsUniformColor, "#define INSTANCED\n" },
+        { &shaderVertexPositionColor, vsVertexPositionColor, fsVertexColor },
+        { &shaderVertexBufferColor, vsColorBufferColor, fsVertexColor },
+        { &shaderPoints, vsPoints, fsVertexColor },
+        { &shaderLines, vsLines, fsLines },
+        { &shaderTcoords, vs, fsTcoords },
+        { &shaderNormals, vs, fsNormals },
+        { &shaderTexture, vs, fsTexture },
+        { &shaderTexturePooledAtlas, vs, fsTexture, "#define POOLED\n#define ATLAS\n" },
+        { &shaderTextureMix, vs, fsTextureMix },
+        { &shaderSkybox, vsSkybox, fsSkybox }
+    };
+
+    // The driver compiles while we load meshes & textures below. Programs finish on first use or in UpdatePrograms
+    CreatePrograms(programs, sizeof(programs) / sizeof(programs[0]));
+
+    // Phong variants are compiled as draws ask for them. The scene's point, direction & spot lights need these two
+    ProgramVariants phong{ vs, fsPhong, PhongDefines };
+    uint32_t sceneFeatures = PhongLights(3) | PHONG_SPOT | PHONG_ATTENUATION;
+    uint32_t phongFeatures[] = { sceneFeatures | PHONG_TEXTURED, sceneFeatures };
+    PrepareVariants(&phong, phongFeatures, 2);
+    printf("Programs: %i submitted in %.2f ms\n", gProgramCacheStats.programs, gProgramCacheStats.submitMs);
+
+    // Saving a shader recompiles every program that uses it (swapped in at the start of a frame)
+    WatchShaders("./assets/shaders");
+
+    // Phong shaders read every light from this buffer
+    GLuint lightBuffer = CreateLightBuffer();
+
+    // Reused every frame so its packets aren't reallocated
+    RenderQueue renderQueue;
 
     // See Diffuse 2.png for context
     //Vector2 N = Rotate(Vector2{ 0.0f, 1.0f }, 30.0f * DEG2RAD);
@@ -128,7 +159,7 @@ int main(void)
     // Note that generating an image ourselves is intuitive in OpenGL's space since it matches 2D array coordinates!
     int texGradientWidth = 256;
     int texGradientHeight = 256;
-    Pixel* pixelsGradient = (Pixel*)malloc(texGradientWidth * texGradientHeight * sizeof(Pixel));
+    std::vector<Pixel> pixelsGradient(texGradientWidth * texGradientHeight);
     for (int y = 0; y < texGradientHeight; y++)
     {
         for (int x = 0; x < texGradientWidth; x++)
@@ -149,21 +180,20 @@ int main(void)
 
 
     // New texture: Dice
-    int texDiceW = 0; // s1
-    int texDiceH = 0;
-    int texDiceC = 0;
-    stbi_uc* pixelD = stbi_load("./assets/textures/dice.png", &texDiceW, &texDiceH, &texDiceC, 0);
-
-    GLuint diceTex = GL_NONE; // s2
-    glGenTextures(1, &diceTex);
-    glBindTexture(GL_TEXTURE_2D, diceTex);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texDiceW, texDiceH, 0, GL_RGB, GL_UNSIGNED_BYTE, pixelD);
-    free(pixelD);
-    pixelD = nullptr;
+    // Decoded on worker threads & streamed in over the first frames, so startup doesn't wait on it.
+    // Drawn with a placeholder until then. Shared through the cache, which keeps every texture within its budget
+    CreateTextureLoader();
+    CreateTextureCache();
+    Texture* diceTexture = AcquireTexture("./assets/textures/dice.png");
+
+    // Case 5's dice & gradient share one texture array, so its draws of both are still one multi-draw.
+    // The dice is decoded by the loader's workers & packed when it arrives, drawn with the atlas's placeholder until then.
+    // The atlas's layers count against the cache's budget, so cached textures shrink to make room for them
+    AtlasRegion atlasRegions[2];
+    TextureAtlas atlas;
+    CreateTextureAtlas(&atlas);
+    AddToAtlas(&atlas, "./assets/textures/dice.png", &atlasRegions[0]);
+    AddToAtlas(&atlas, AtlasImage{ (const uint8_t*)pixelsGradient.data(), texGradientWidth, texGradientHeight }, &atlasRegions[1]);
 
 
     //stbi_set_flip_vertically_on_load(true);
@@ -188,11 +218,55 @@ int main(void)
     bool camToggle = false;
 
     Mesh sphereMesh, planeMesh, diceMesh;
+    diceMesh.format = VERTEX_PACKED;
 
     CreateMesh(&diceMesh, "assets/meshes/cube.obj");
     CreateMesh(&sphereMesh, SPHERE);
     CreateMesh(&planeMesh, PLANE);
 
+    // Case 5 draws every sphere & dice of its grid from one pool with a single multi-draw
+    GeometryPool geometryPool;
+    CreateGeometryPool(&geometryPool, 1 << 16, 1 << 18);
+    PoolMesh pooledSphere = AddToPool(&geometryPool, sphereMesh);
+    PoolMesh pooledDice = AddToPool(&geometryPool, diceMesh);
+    int pooledDraws = 0;
+
+    // The pool's grid doesn't move, so its transforms & the centers of its objects are built once.
+    // Each frame transforms every center to view space in one batch to pick the objects' LODs
+    const int poolSide = 32;
+    const float poolScale = 0.4f;
+    std::vector<Matrix> poolWorlds, poolNormals;
+    std::vector<Vector3> poolCenters;
+    std::vector<Vector3> poolViewCenters(poolSide * poolSide);
+    for (int z = 0; z < poolSide; z++)
+    {
+        for (int x = 0; x < poolSide; x++)
+        {
+            const Mesh& mesh = (x + z) % 2 == 0 ? diceMesh : sphereMesh;
+            Matrix world = Scale(V3_ONE * poolScale) * Translate(x - poolSide * 0.5f, -2.0f, z - poolSide * 0.5f);
+            poolWorlds.push_back(world);
+            poolNormals.push_back(NormalMatrix(world));
+            poolCenters.push_back(Multiply((mesh.boundsMin + mesh.boundsMax) * 0.5f, world));
+        }
+    }
+
+    // Case 4's crowd of spheres on a grid, each tinted by where it is. Drawn in one instanced call at the coarsest LOD
+    const int crowdSide = 316;
+    std::vector<Matrix> crowdWorlds;
+    std::vector<Vector3> crowdColors;
+    crowdWorlds.reserve(crowdSide * crowdSide);
+    crowdColors.reserve(crowdSide * crowdSide);
+    for (int z = 0; z < crowdSide; z++)
+    {
+        for (int x = 0; x < crowdSide; x++)
+        {
+            float u = x / (float)(crowdSide - 1);
+            float v = z / (float)(crowdSide - 1);
+            crowdWorlds.push_back(Scale(V3_ONE * 0.4f) * Translate(x - crowdSide * 0.5f, -2.0f, z - crowdSide * 0.5f));
+            crowdColors.push_back({ u, 1.0f - u * v, v });
+        }
+    }
+
     float camPitch = 0.0f;
     float camYaw = 0.0f;
     //Vector3 camPos = V3_ZERO;
@@ -224,20 +298,30 @@ int main(void)
     float diffuseFactor = 0.5f;
     float specularPower = 125.0f;
 
+    // Textures above were created with raw binds the state tracker didn't see
+    InvalidateGLState();
+
     // Render looks weird cause this isn't enabled, but its causing unexpected problems which I'll fix soon!
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
+    SetDepthTest(true);
+    SetDepthFunc(GL_LEQUAL);
 
     float timePrev = glfwGetTime();
     float timeCurr = glfwGetTime();
     float dt = 0.0f;
 
     double pmx = 0.0, pmy = 0.0, mx = 0.0, my = 0.0;
+    // Time to first frame shouldn't grow with the number or size of textures
+    bool firstFrame = true;
+
     /* Loop until the user closes the window */
     while (!glfwWindowShouldClose(window))
     {
         float time = glfwGetTime();
         timePrev = time;
+        ResetUniformStats();
+        ResetGLStateStats();
+        UpdatePrograms();
+        UpdateTextures();
 
         pmx = mx; pmy = my;
         glfwGetCursorPos(window, &mx, &my);
@@ -256,6 +340,9 @@ int main(void)
         if (IsKeyPressed(GLFW_KEY_T))
             texToggle = !texToggle;
 
+        if (IsKeyPressed(GLFW_KEY_B))
+            RunBenchmarks();
+
         if (IsKeyPressed(GLFW_KEY_C))
         {
             camToggle = !camToggle;
@@ -353,42 +440,8 @@ int main(void)
         Matrix world = MatrixIdentity();
         Matrix view = LookAt(camPos, camPos + camForward, camUp);
         Matrix proj = projection == ORTHO ? Ortho(left, right, bottom, top, near, far) : Perspective(fov, SCREEN_ASPECT, near, far);
-        Matrix mvp;
-
-        GLuint u_color = -2;
-        GLint u_normal = -2;
-        GLint u_world = -2;
-        GLint u_mvp = -2;
-        GLint u_tex = -2;
-        GLint u_textureSlots[2]{ -2, -2 };
-        GLuint shaderProgram = GL_NONE;
-        GLint u_t = GL_NONE;
-
-        // -- Light Handles --
-
-        GLint u_camPos = -2;
-
-        // Orbit Light
-        GLint u_litePos = -2;
-        GLint u_liteDir = -2;
-        GLint u_liteCol = -2;
-        GLint u_liteRad = -2;
-
-        // Direction Light
-        GLint u_dirLitePos = -2;
-        GLint u_dirLiteRad = -2;
-
-        // Spot Light
-        GLint u_spoLCamPos = -2;
-        GLint u_spoLitePos = -2;
-        GLint u_spoLiteCol = -2;
-        GLint u_spoLiteDir = -2;
-        GLint u_spoLiteRad = -2;
-
-        // Light Effects
-        GLint u_facAmb = -2; // Ambient
-        GLint u_facDfue = -2; // Defuse
-        GLint u_powSpur = -2; // Specular
+        Light lights[3];
+        Material lightMaterial, diceMaterial, planeMaterial;
 
         // Extra practice: render the skybox here and it should be applied to cases 1-5!
         // You may need to tweak a few things like matrix values and depth state in order for everything to work correctly.
@@ -403,125 +456,88 @@ int main(void)
 
             // Phong
         case 3:
-            // SpotLight
-            shaderProgram = shaderUniformColor;
-            glUseProgram(shaderProgram);
-            world = Scale(V3_ONE * dirLiteRad) * Translate(dirLitePos);
-            mvp = world * view * proj;
-            u_mvp = glGetUniformLocation(shaderProgram, "u_mvp");
-            u_color = glGetUniformLocation(shaderProgram, "u_color");
-            glUniformMatrix4fv(u_mvp, 1, GL_FALSE, ToFloat16(mvp).v);
-            glUniform3fv(u_color, 1, &liteCol.x);
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            DrawMesh(sphereMesh);
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-            // Orbit Light
-            shaderProgram = shaderUniformColor;
-            glUseProgram(shaderProgram);
-
             // orbit translation
             //litePos.x = litePos.x * sin(time);
             //litePos.z = litePos.z * cos(time);
             litePos = { 2.5f * sin(time), 5.0f, 2.0f * cos(time) };
 
-            world = Scale(V3_ONE * dirLiteRad) * Translate(litePos);
-            mvp = world * view * proj;
-            u_mvp = glGetUniformLocation(shaderProgram, "u_mvp");
-            u_color = glGetUniformLocation(shaderProgram, "u_color");
-            glUniformMatrix4fv(u_mvp, 1, GL_FALSE, ToFloat16(mvp).v);
-            glUniform3fv(u_color, 1, &liteCol.x);
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            DrawMesh(sphereMesh);
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            // All lights are uploaded once per frame now that the orbit light has moved
+            lights[0].type = LIGHT_POINT;
+            lights[0].position = litePos;
+            lights[0].color = liteCol;
+            lights[0].radius = liteRad;
+            lights[1].type = LIGHT_DIRECTION;
+            lights[1].position = dirLitePos;
+            lights[1].color = liteCol;
+            lights[1].radius = dirLiteRad;
+            lights[2].type = LIGHT_SPOT;
+            lights[2].position = spoLitePos;
+            lights[2].color = spoLiteCol;
+            lights[2].direction = spoLiteDir;
+            lights[2].angle = spoLiteRad;
+            UpdateLightBuffer(lightBuffer, camPos, lights, 3);
+
+            // SpotLight & Orbit Light
+            lightMaterial.program = &shaderUniformColor;
+            lightMaterial.instancedProgram = &shaderUniformColorInstanced;
+            lightMaterial.color = liteCol;
+            lightMaterial.wireframe = true;
+            SubmitDraw(&renderQueue, &lightMaterial, &sphereMesh, Scale(V3_ONE * dirLiteRad) * Translate(dirLitePos), normal);
+            SubmitDraw(&renderQueue, &lightMaterial, &sphereMesh, Scale(V3_ONE * dirLiteRad) * Translate(litePos), normal);
 
             // Dice Render & Direction Light
-            shaderProgram = shaderPhongColor;
-            glUseProgram(shaderProgram);
+            diceMaterial.program = GetVariant(&phong, PhongFeatures(true, lights, 3));
+            diceMaterial.texture = UseTexture(diceTexture);
             world = Translate(0.0f, 4.0f, 0.0f);
             scale = 3.0f;
             matrixScale = Scale(scale, scale, scale);
-            mvp = matrixScale * world * view * proj;
-
-            u_world = glGetUniformLocation(shaderProgram, "u_world");
-            u_normal = glGetUniformLocation(shaderProgram, "u_normal");
-            u_mvp = glGetUniformLocation(shaderProgram, "u_mvp");
-            u_tex = glGetUniformLocation(shaderProgram, "u_tex");
-
-            u_camPos = glGetUniformLocation(shaderProgram, "u_camPos");
-            u_litePos = glGetUniformLocation(shaderProgram, "u_litePos");
-            u_liteRad = glGetUniformLocation(shaderProgram, "u_liteRad");
-            u_liteCol = glGetUniformLocation(shaderProgram, "u_liteCol");
-
-            u_dirLitePos = glGetUniformLocation(shaderProgram, "u_dirLitePos");
-            u_dirLiteRad = glGetUniformLocation(shaderProgram, "u_dirLiteRad");
-
-            u_spoLCamPos = glGetUniformLocation(shaderProgram, "u_spoLCamPos");
-            u_spoLiteCol = glGetUniformLocation(shaderProgram, "u_spoLiteCol");
-            u_spoLiteDir = glGetUniformLocation(shaderProgram, "u_spoLiteDir");
-            u_spoLitePos = glGetUniformLocation(shaderProgram, "u_spoLitePos");
-            u_spoLiteRad = glGetUniformLocation(shaderProgram, "u_spoLiteRad");
-
-            glUniformMatrix4fv(u_world, 1, GL_FALSE, ToFloat16(world).v);
-            glUniformMatrix3fv(u_normal, 1, GL_FALSE, ToFloat9(normal).v);
-            glUniformMatrix4fv(u_mvp, 1, GL_FALSE, ToFloat16(mvp).v);
-
-            glUniform3fv(u_litePos, 1, &camPos.x);
-            glUniform3fv(u_litePos, 1, &litePos.x);
-            glUniform3fv(u_liteCol, 1, &liteCol.x);
-            glUniform1f(u_liteRad, liteRad);
-
-            glUniform3fv(u_dirLitePos, 1, &dirLitePos.x);
-            glUniform1f(u_dirLiteRad, dirLiteRad);
-
-            glUniform3fv(u_spoLitePos, 1, &camPos.x);
-            glUniform3fv(u_spoLitePos, 1, &spoLitePos.x);
-            glUniform3fv(u_spoLiteCol, 1, &spoLiteCol.x);
-            glUniform3fv(u_spoLiteDir, 1, &spoLiteDir.x);
-            glUniform1f(u_spoLiteRad, spoLiteRad);
-
-            glUniform1i(u_tex, 0);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, diceTex);
-            DrawMesh(diceMesh);
+            SubmitDraw(&renderQueue, &diceMaterial, &diceMesh, matrixScale * world, normal);
 
             // Plane
-            shaderProgram = shaderPhongGrey;
-            glUseProgram(shaderProgram);
+            planeMaterial.program = GetVariant(&phong, PhongFeatures(false, lights, 3));
             //world = Scale(planeValues, planeValues, planeValues) * RotateX(rotationAmount) * Translate(-planeValues / 2, -1.5f, -planeValues / 2);
             world = Scale(10.0f, 10.0f, 10.0f) * Translate(-3.0f, -5.0f, 1.0f) * RotateX(90.0f * DEG2RAD);
-            mvp = world * view * proj;
-
-            u_world = glGetUniformLocation(shaderProgram, "u_world");
-            u_normal = glGetUniformLocation(shaderProgram, "u_normal");
-            u_mvp = glGetUniformLocation(shaderProgram, "u_mvp");
+            SubmitDraw(&renderQueue, &planeMaterial, &planeMesh, world, normal);
 
-            u_camPos = glGetUniformLocation(shaderProgram, "u_camPos");
-            u_litePos = glGetUniformLocation(shaderProgram, "u_litePos");
-            u_liteCol = glGetUniformLocation(shaderProgram, "u_liteCol");
-            u_liteRad = glGetUniformLocation(shaderProgram, "u_liteRad");
-
-            glUniformMatrix4fv(u_world, 1, GL_FALSE, ToFloat16(world).v);
-            glUniformMatrix3fv(u_normal, 1, GL_FALSE, ToFloat9(normal).v);
-            glUniformMatrix4fv(u_mvp, 1, GL_FALSE, ToFloat16(mvp).v);
-
-            glUniform3fv(u_litePos, 1, &camPos.x);
-            glUniform3fv(u_litePos, 1, &litePos.x);
-            glUniform3fv(u_liteCol, 1, &liteCol.x);
-            glUniform1f(u_liteRad, liteRad);
-
-            glUniformMatrix4fv(u_mvp, 1, GL_FALSE, ToFloat16(mvp).v);
-            DrawMesh(planeMesh);
+            // Sorted so objects sharing a program, texture or mesh are drawn back to back
+            DrawRenderQueue(&renderQueue, view, proj, SCREEN_HEIGHT);
             break;
 
 
         case 4:
+            UseProgram(&shaderUniformColorInstanced);
+            SetUniform(&shaderUniformColorInstanced, U_COLOR, V3_ONE);
+            SetUniform(&shaderUniformColorInstanced, U_VIEW_PROJ, view * proj);
+            DrawMeshInstanced(sphereMesh, crowdWorlds.data(), crowdColors.data(), (int)crowdWorlds.size(), (int)sphereMesh.lods.size());
             break;
 
         case 5:
+            TransformPoints(view, ToSpan(poolCenters.data()), ToSpan(poolViewCenters.data()), poolCenters.size());
+            for (int z = 0; z < poolSide; z++)
+            {
+                for (int x = 0; x < poolSide; x++)
+                {
+                    int i = z * poolSide + x;
+                    bool dice = (x + z) % 2 == 0;
+                    const Mesh& mesh = dice ? diceMesh : sphereMesh;
+                    int level = SelectLod(mesh, poolScale, -poolViewCenters[i].z, proj, SCREEN_HEIGHT);
+                    Vector3 color = { x / (poolSide - 1.0f), 0.5f, z / (poolSide - 1.0f) };
+                    SubmitPoolDraw(&geometryPool, dice ? pooledDice : pooledSphere, level, poolWorlds[i], poolNormals[i], color, atlasRegions[dice ? 0 : 1]);
+                }
+            }
+            pooledDraws = (int)geometryPool.commands.size();
+
+            UseProgram(&shaderTexturePooledAtlas);
+            BindTexture(0, atlas.id);
+            SetUniform(&shaderTexturePooledAtlas, U_TEX, 0);
+            SetUniform(&shaderTexturePooledAtlas, U_VIEW_PROJ, view * proj);
+            DrawGeometryPool(&geometryPool);
             break;
         }
 
+        // Textures not drawn with this frame are the first to go if we're over budget
+        UpdateTextureCache();
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -529,6 +545,37 @@ int main(void)
             ImGui::ShowDemoWindow();
         else
         {
+            // Every set used to look its uniform up by name
+            ImGui::Text("Frame time: %.2f ms", dt * 1000.0f);
+            ImGui::Text("Uniform lookups per frame: %i before caching, %i now", gUniformStats.sets, gUniformStats.lookups);
+            ImGui::Text("Uniform uploads: %i (%i unchanged values skipped)", gUniformStats.uploads, gUniformStats.skipped);
+            ImGui::Text("Draws: %i in %i calls, state changes: %i (%i in submission order, %i avoided by sorting & sharing)",
+                renderQueue.stats.draws, renderQueue.stats.drawCalls, renderQueue.stats.changes, renderQueue.stats.unsortedChanges, renderQueue.stats.avoided);
+            ImGui::Text("GL state calls: %i issued, %i filtered as redundant", gStateStats.issued, gStateStats.filtered);
+            ImGui::Text("Textures: %i loaded, %i decoding, %i uploading, %zu KB uploaded this frame", gTextureStats.loaded,
+                gTextureStats.decoding, gTextureStats.uploading, gTextureStats.uploadedBytes / 1024);
+            if (ImGui::TreeNode("Texture cache", "Texture cache: %i textures, %zu / %zu KB resident (%zu KB atlas), %i evicted, %i mips dropped, %i reloaded",
+                gTextureCacheStats.textures, gTextureCacheStats.residentBytes / 1024, gTextureCacheStats.budgetBytes / 1024,
+                gTextureCacheStats.trackedBytes / 1024, gTextureCacheStats.evicted, gTextureCacheStats.dropped, gTextureCacheStats.reloaded))
+            {
+                for (const CachedTexture* cached : CachedTextures())
+                {
+                    const Texture& texture = cached->texture;
+                    ImGui::Text("%s: %ix%i, %zu KB, %i refs, %i mips dropped", texture.path.c_str(), texture.width >> texture.dropped,
+                        texture.height >> texture.dropped, TextureBytes(texture) / 1024, cached->refs, texture.dropped);
+                }
+                ImGui::TreePop();
+            }
+            if (object + 1 == 4)
+                ImGui::Text("Crowd: %i spheres in 1 instanced draw", (int)crowdWorlds.size());
+            if (object + 1 == 5)
+            {
+                ImGui::Text("Pool: %i draws of 2 meshes in 1 multi-draw, %u/%u vertices & %u/%u indices used", pooledDraws,
+                    geometryPool.vertexCount, geometryPool.vertexCapacity, geometryPool.indexCount, geometryPool.indexCapacity);
+                ImGui::Text("Atlas: %i textures (%i decoding) in %i %ix%i layer(s), %zu KB, %.0f%% covered, 1 bind", atlas.images, atlas.pending,
+                    atlas.layers, atlas.size, atlas.size, TextureAtlasBytes(atlas) / 1024, atlas.used * 100.0f);
+            }
+
             ImGui::SliderFloat3("Camera Position", &camPos.x, -10.0f, 10.0f);
             ImGui::SliderFloat3("Light Position", &litePos.x, -10.0f, 10.0f);
             ImGui::SliderFloat("Light Radius", &liteRad, 0.25f, 5.0f);
@@ -563,12 +610,26 @@ int main(void)
 
         /* Swap front and back buffers */
         glfwSwapBuffers(window);
+        if (firstFrame)
+        {
+            printf("First frame after %.2f ms\n", glfwGetTime() * 1000.0);
+            firstFrame = false;
+        }
 
         /* Poll and process events */
         memcpy(gKeysPrev.data(), gKeysCurr.data(), GLFW_KEY_LAST * sizeof(int));
         glfwPollEvents();
     }
 
+    UnwatchShaders();
+    ReleaseTexture(diceTexture);
+    DestroyTextureCache();
+    DestroyTextureAtlas(&atlas);
+    DestroyTextureLoader();
+    DestroyGeometryPool(&geometryPool);
+    DestroyVariants(&phong);
+    DestroyLightBuffer(&lightBuffer);
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -597,85 +658,6 @@ void error_callback(int error, const char* description)
     printf("GLFW Error %d: %s\n", error, description);
 }
 
-// Compile a shader
-GLuint CreateShader(GLint type, const char* path)
-{
-    GLuint shader = GL_NONE;
-    try
-    {
-        // Load text file
-        std::ifstream file;
-        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        file.open(path);
-
-        // Interpret the file as a giant string
-        std::stringstream stream;
-        stream << file.rdbuf();
-        file.close();
-
-        // Verify shader type matches shader file extension
-        const char* ext = strrchr(path, '.');
-        switch (type)
-        {
-        case GL_VERTEX_SHADER:
-            assert(strcmp(ext, ".vert") == 0);
-            break;
-
-        case GL_FRAGMENT_SHADER:
-            assert(strcmp(ext, ".frag") == 0);
-            break;
-        default:
-            assert(false, "Invalid shader type");
-            break;
-        }
-
-        // Compile text as a shader
-        std::string str = stream.str();
-        const char* src = str.c_str();
-        shader = glCreateShader(type);
-        glShaderSource(shader, 1, &src, NULL);
-        glCompileShader(shader);
-
-        // Check for compilation errors
-        GLint success;
-        GLchar infoLog[512];
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(shader, 512, NULL, infoLog);
-            std::cout << "Shader failed to compile: \n" << infoLog << std::endl;
-        }
-    }
-    catch (std::ifstream::failure& e)
-    {
-        std::cout << "Shader (" << path << ") not found: " << e.what() << std::endl;
-        assert(false);
-    }
-
-    return shader;
-}
-
-// Combine two compiled shaders into a program that can run on the GPU
-GLuint CreateProgram(GLuint vs, GLuint fs)
-{
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vs);
-    glAttachShader(program, fs);
-    glLinkProgram(program);
-
-    // Check for linking errors
-    int success;
-    char infoLog[512];
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        program = GL_NONE;
-        glGetProgramInfoLog(program, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-
-    return program;
-}
-
 // Graphics debug callback
 void APIENTRY glDebugOutput(GLenum source, GLenum type, unsigned int id, GLenum severity, GLsizei length, const char* message, const void* userParam)
 {